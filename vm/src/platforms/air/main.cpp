@@ -0,0 +1,241 @@
+/*   ____       _  __ _   ____            _
+ *  |  _ \  ___| |/ _| |_|  _ \ _ __ ___ | |_ ___
+ *  | | | |/ _ \ | |_| __| |_) | '__/ _ \| __/ _ \
+ *  | |_| |  __/ |  _| |_|  __/| | ( (_) | |( (_) )
+ *  |____/ \___|_|_|  \__|_|   |_|  \___/ \__\___/
+ *
+ * This file is part of DelftProto.
+ * See COPYING for license details.
+ */
+
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+
+extern "C" {
+#	include <sched.h>
+#	include <signal.h>
+#	include <sys/mman.h>
+#	include <sys/wait.h>
+#	include <time.h>
+#	include <unistd.h>
+}
+
+#include <instructions.hpp>
+#include <machine.hpp>
+#include <message.hpp>
+#include <air.hpp>
+
+using namespace std;
+
+namespace {
+	using namespace Instructions;
+	
+	// The distance to device 0, along a path of links that are 0.3 long:
+	// (rep d inf (mux (= (mid) 0) 0 (+ (min-hood (nbr d)) 0.3)))
+	Int8 script[] = { DEF_VM_EX_OP, 16, 8, 2, 1, 1, 1, 4,
+	                  DEF_FUN_2_OP, INF_OP, RET_OP,
+	                  DEF_FUN_OP, 19,
+	                    MID_OP, LIT_0_OP, EQ_OP,
+	                    LIT_0_OP,
+	                    GLO_REF_0_OP, INIT_FEEDBACK_OP, 0,
+	                    HOOD_MIN_OP, 0,
+	                    LIT_FLO_OP, 0x9A, 0x99, 0x99, 0x3E,
+	                    ADD_OP,
+	                    MUX_OP,
+	                    SET_FEEDBACK_OP, 0,
+	                  RET_OP,
+	                  ACTIVATE_OP, 0,
+	                  EXIT_OP };
+	
+	const double link = 0.3;
+	
+	// What a device reports back to the launcher, in memory shared with it.
+	struct Report {
+		unsigned long rounds;
+		unsigned long received;
+		double seconds;
+	};
+	
+	// The memory shared by the launcher and the devices it started.
+	struct Shared {
+		Size ready; // The number of devices that joined the region.
+		bool go;    // Set by the launcher when all devices are ready.
+	};
+	
+	double now() {
+		timespec t;
+		clock_gettime(CLOCK_MONOTONIC, &t);
+		return t.tv_sec + t.tv_nsec * 1e-9;
+	}
+	
+	// The devices are on a square grid, and hear the (up to eight) devices around them.
+	Size neighbours(Index device, Size count, Index * result) {
+		Size width = Size(std::ceil(std::sqrt(double(count))));
+		long x = device % width;
+		long y = device / width;
+		Size found = 0;
+		for(long dy = -1; dy <= 1; dy++) for(long dx = -1; dx <= 1; dx++){
+			if (!dx && !dy) continue;
+			if (x + dx < 0 || x + dx >= long(width) || y + dy < 0) continue;
+			Index n = Index((y + dy) * width + x + dx);
+			if (n < count) result[found++] = n;
+		}
+		return found;
+	}
+	
+	// The distance a device should have found: the number of hops on the grid, times the length of a link.
+	double distance(Index device, Size count) {
+		Size width = Size(std::ceil(std::sqrt(double(count))));
+		Size x = device % width;
+		Size y = device / width;
+		return link * (x > y ? x : y);
+	}
+	
+	// Run one device: every round, decode the new messages of its neighbours, run the machine, and publish its exports.
+	void device(char const * path, Index index, Size count, Size rounds, long period, Shared & shared, Report & report) {
+		Air air(path, 0);
+		if (!air.valid()){
+			cerr << "device " << index << ": can not join " << path << endl;
+			_exit(1);
+		}
+		Machine machine;
+		machine.id = MachineId(index);
+		machine.install(Script(script, sizeof(script)));
+		while(!machine.finished()) machine.step();
+		ExportEncoder encoder(machine.currentScript());
+		ExportDecoder decoder(machine.currentScript());
+		
+		Index hood[8];
+		Size sequences[8] = { 0 };
+		Size hood_size = neighbours(index, count, hood);
+		
+		__atomic_add_fetch(&shared.ready, 1, __ATOMIC_ACQ_REL);
+		while(!__atomic_load_n(&shared.go, __ATOMIC_ACQUIRE)) sched_yield();
+		
+		double start = now();
+		for(Size round = 1; round <= rounds; round++){
+			Int8 message[AIR_MESSAGE_SIZE];
+			for(Index n = 0; n < hood_size; n++){
+				MachineId from;
+				Size size = air.read(hood[n], sequences[n], from, message);
+				if (!size) continue;
+				NeighbourHood::iterator neighbour = machine.hood.heard(from, Time(round));
+				if (neighbour != machine.hood.end() && decoder.decode(machine.hood, neighbour, message, size)) report.received++;
+			}
+			machine.run(Time(round));
+			while(!machine.finished()) machine.step();
+			air.publish(index, machine.id, message, encoder.encode(machine.thisMachine().imports, message, sizeof(message)));
+			report.rounds = round;
+			if (period){
+				timespec pause = { period / 1000000, period % 1000000 * 1000 };
+				nanosleep(&pause, 0);
+			} else {
+				sched_yield();
+			}
+		}
+		report.seconds = now() - start;
+		_exit(0);
+	}
+	
+	// Decode the last message of every device, and count the devices that found the right distance.
+	Size check(Air & air, Size count) {
+		Machine machine;
+		machine.install(Script(script, sizeof(script)));
+		while(!machine.finished()) machine.step();
+		ExportDecoder decoder(machine.currentScript());
+		NeighbourHood::iterator neighbour = machine.hood.add(MachineId(-1));
+		Size correct = 0;
+		for(Index d = 0; d < count; d++){
+			Int8 message[AIR_MESSAGE_SIZE];
+			Size sequence = 0;
+			MachineId from;
+			Size size = air.read(d, sequence, from, message);
+			if (!size || !decoder.decode(machine.hood, neighbour, message, size) || !neighbour->imports[0].isSet()) continue;
+			if (std::fabs(toDouble(neighbour->imports[0].asNumber()) - distance(d, count)) < 0.01) correct++;
+		}
+		return correct;
+	}
+}
+
+// Emulates a number of devices on a grid, each in a process of its own, which broadcast their exports through an Air region.
+// Usage: dpvm <devices> [rounds] [microseconds between rounds] [region file]
+int main(int argc, char * argv[]){
+	Size count = argc > 1 ? atol(argv[1]) : 0;
+	Size rounds = argc > 2 ? atol(argv[2]) : 100;
+	if (argc < 2 || argc > 5 || !count || !rounds){
+		cerr << "usage: " << argv[0] << " <devices> [rounds] [microseconds between rounds] [region file]" << endl;
+		return 2;
+	}
+	long period = argc > 3 ? atol(argv[3]) : 0;
+	char const * path = argc > 4 ? argv[4] : "/dev/shm/delftproto-air";
+	
+	Air air(path, count);
+	if (!air.valid()){
+		cerr << "can not create " << path << endl;
+		return 1;
+	}
+	void * memory = mmap(0, sizeof(Shared) + count * sizeof(Report), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (memory == MAP_FAILED){
+		cerr << "can not map the reports" << endl;
+		return 1;
+	}
+	Shared & shared = *static_cast<Shared *>(memory);
+	Report * reports = reinterpret_cast<Report *>(static_cast<Shared *>(memory) + 1);
+	
+	pid_t * devices = new pid_t[count];
+	Size started = 0;
+	for(; started < count; started++){
+		devices[started] = fork();
+		if (devices[started] == 0) device(path, started, count, rounds, period, shared, reports[started]);
+		if (devices[started] < 0){
+			cerr << "can not start device " << started << endl;
+			break;
+		}
+	}
+	// Wait until all devices joined the region. A device that exits before that (because it could not join) failed.
+	bool failed = started < count;
+	while(!failed && __atomic_load_n(&shared.ready, __ATOMIC_ACQUIRE) < count){
+		int status;
+		pid_t exited = waitpid(-1, &status, WNOHANG);
+		if (exited <= 0){
+			sched_yield();
+			continue;
+		}
+		for(Index d = 0; d < started; d++) if (devices[d] == exited) devices[d] = 0;
+		failed = true;
+	}
+	
+	double start = now();
+	if (!failed) __atomic_store_n(&shared.go, true, __ATOMIC_RELEASE);
+	for(Index d = 0; d < started; d++){
+		if (!devices[d]) continue;
+		if (failed) kill(devices[d], SIGTERM);
+		int status;
+		if (waitpid(devices[d], &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status)) failed = true;
+	}
+	double seconds = now() - start;
+	delete[] devices;
+	
+	if (!failed){
+		unsigned long received = 0;
+		double latency = 0;
+		double slowest = 0;
+		for(Index d = 0; d < count; d++){
+			received += reports[d].received;
+			double round = reports[d].seconds / reports[d].rounds;
+			latency += round / count;
+			if (round > slowest) slowest = round;
+		}
+		cout << count << " devices, " << rounds << " rounds in " << seconds << " s" << endl;
+		cout << "  " << received / seconds << " messages/s received" << endl;
+		cout << "  " << latency * 1e6 << " us/round on average, " << slowest * 1e6 << " us/round for the slowest device" << endl;
+		cout << "  " << check(air, count) << " of " << count << " devices found the right distance" << endl;
+	}
+	
+	munmap(memory, sizeof(Shared) + count * sizeof(Report));
+	Air::remove(path);
+	return failed ? 1 : 0;
+}
@@ -19,11 +19,26 @@ typedef unsigned int   Counter;
 typedef unsigned char  Int8;
 typedef unsigned int   Int16;
 typedef unsigned int   Int;
-typedef float          Number;
 typedef unsigned char  Alignment;
 
+#ifdef FIXED_POINT_NUMBER
+
+#include <fixed.hpp>
+
+typedef Fixed<FIXED_POINT_NUMBER> Number;
+
+namespace {
+	const Number Number_infinity = Number::infinity();
+}
+
+#else
+
+typedef float Number;
+
 namespace {
 	const Number Number_infinity = 1.0f / 0.0f;
 }
 
 #endif
+
+#endif
@@ -0,0 +1,104 @@
+/*   ____       _  __ _   ____            _
+ *  |  _ \  ___| |/ _| |_|  _ \ _ __ ___ | |_ ___
+ *  | | | |/ _ \ | |_| __| |_) | '__/ _ \| __/ _ \
+ *  | |_| |  __/ |  _| |_|  __/| | ( (_) | |( (_) )
+ *  |____/ \___|_|_|  \__|_|   |_|  \___/ \__\___/
+ *
+ * This file is part of DelftProto.
+ * See COPYING for license details.
+ */
+
+
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+
+#include <instructions.hpp>
+#include <machine.hpp>
+#include <message.hpp>
+#include <air.hpp>
+
+#include "benchmark.hpp"
+
+namespace {
+	using namespace Instructions;
+	
+	// A machine with eight exports and nothing to run.
+	Int8 script[] = { DEF_VM_EX_OP, 4, 4, 0, 0, 0, 8, 1, EXIT_OP };
+	
+	char const * const path = "/dev/shm/delftproto-benchmark-air";
+	
+	// The number of devices in the region (one slot each), as if there was a process for every one of them.
+	const Size slot_counts[] = { 100, 1000, 10000 };
+	
+	// About this many messages are read for every slot count.
+	const unsigned long message_count = 4000000;
+	
+	// The devices are on a square grid, and hear the (up to eight) devices around them.
+	Size neighbours(Index device, Size count, Size width, Index * result) {
+		long x = device % width;
+		long y = device / width;
+		Size found = 0;
+		for(long dy = -1; dy <= 1; dy++) for(long dx = -1; dx <= 1; dx++){
+			if (!dx && !dy) continue;
+			if (x + dx < 0 || x + dx >= long(width) || y + dy < 0) continue;
+			Index n = Index((y + dy) * width + x + dx);
+			if (n < count) result[found++] = n;
+		}
+		return found;
+	}
+}
+
+// Measures the Air transport with a device for every slot of a region, all on a grid, emulated by this one process:
+// every round, every device publishes a message (eight Numbers) and reads the new messages of the devices around it.
+// Reports the messages read per second, and the time a round of all devices takes.
+// The processes of real devices (see the air platform) also pay for moving the slots between processor caches.
+void Benchmark::air(){
+	Machine machine;
+	machine.install(Script(script, sizeof(script)));
+	while(!machine.finished()) machine.step();
+	for(Index i = 0; i < 8; i++) machine.hood.update(machine.hood.begin(), i, Number(i * 1.5 + 0.25));
+	ExportEncoder encoder(machine.currentScript());
+	Int8 message[AIR_MESSAGE_SIZE];
+	Size size = encoder.encode(machine.thisMachine().imports, message, sizeof(message));
+	
+	for(Index c = 0; c < sizeof(slot_counts) / sizeof(*slot_counts); c++){
+		Size count = slot_counts[c];
+		Air air(path, count);
+		if (!air.valid()){
+			std::cout << "air: can not create " << path << std::endl;
+			return;
+		}
+		Size width = Size(std::ceil(std::sqrt(double(count))));
+		Index * hoods = new Index[count * 8];
+		Size * hood_sizes = new Size[count];
+		Size * sequences = new Size[count * 8];
+		for(Index d = 0; d < count; d++){
+			hood_sizes[d] = neighbours(d, count, width, &hoods[d * 8]);
+			for(Index n = 0; n < 8; n++) sequences[d * 8 + n] = 0;
+		}
+		
+		Size rounds = message_count / (count * 8) + 1;
+		unsigned long received = 0;
+		Timer timer;
+		for(Size round = 0; round < rounds; round++){
+			for(Index d = 0; d < count; d++) air.publish(d, MachineId(d), message, size);
+			for(Index d = 0; d < count; d++){
+				for(Index n = 0; n < hood_sizes[d]; n++){
+					Int8 buffer[AIR_MESSAGE_SIZE];
+					MachineId from;
+					if (air.read(hoods[d * 8 + n], sequences[d * 8 + n], from, buffer)) received++;
+				}
+			}
+		}
+		char name[32];
+		std::sprintf(name, "air/%u", unsigned(count));
+		timer.report(name, variant(), received, "message");
+		timer.report(name, variant(), rounds, "round");
+		
+		delete[] sequences;
+		delete[] hood_sizes;
+		delete[] hoods;
+		Air::remove(path);
+	}
+}
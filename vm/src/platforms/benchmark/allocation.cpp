@@ -0,0 +1,82 @@
+/*   ____       _  __ _   ____            _
+ *  |  _ \  ___| |/ _| |_|  _ \ _ __ ___ | |_ ___
+ *  | | | |/ _ \ | |_| __| |_) | '__/ _ \| __/ _ \
+ *  | |_| |  __/ |  _| |_|  __/| | ( (_) | |( (_) )
+ *  |____/ \___|_|_|  \__|_|   |_|  \___/ \__\___/
+ *
+ * This file is part of DelftProto.
+ * See COPYING for license details.
+ */
+
+#include <iostream>
+
+#include <machine.hpp>
+
+#include "benchmark.hpp"
+
+namespace {
+	const unsigned long tuple_count = 2000000;
+	const unsigned long neighbour_count = 1000000;
+	const Size window = 64;
+	
+	// A small linear congruential generator, to get the same sequence on every platform.
+	inline unsigned long next(unsigned long & seed) {
+		seed = seed * 1103515245ul + 12345ul;
+		return (seed >> 8) & 0xFFFFFF;
+	}
+	
+#if defined(POOL_MEMORY) || defined(STATIC_MEMORY)
+	// Prints the pool usage, while the data of the benchmark is still alive.
+	void report_pool() {
+		Pool::Statistics const & statistics = Pool::statistics();
+		std::cout << "  pool: " << statistics.reserved << " bytes reserved in " << statistics.chunks << " chunks, "
+		          << statistics.used << " bytes in use in " << statistics.blocks << " blocks, "
+		          << statistics.internalFragmentation() << " bytes internal and "
+		          << statistics.externalFragmentation() << " bytes external fragmentation" << std::endl;
+	}
+#else
+	inline void report_pool() {}
+#endif
+	
+	// Tuples are only compacted between runs, which are simulated here by every 16th tuple.
+	const unsigned long tuples_per_run = 16;
+}
+
+// Measures the throughput of the memory allocator, for the allocations the VM does most.
+void Benchmark::allocation(){
+	unsigned long seed = 1;
+	
+	// Tuples of 1 to 8 elements, each replacing a random one of the last 64 (a tuple header and an element array per tuple).
+	{
+		Array<Tuple> live(window);
+		Timer timer;
+		for(unsigned long i = 0; i < tuple_count; i++){
+			Size size = 1 + next(seed) % 8;
+			Tuple tuple(size);
+			for(Index j = 0; j < size; j++) tuple.push(Number(j));
+			live[next(seed) % window] = tuple;
+#ifdef HEAP_SIZE
+			if (i % tuples_per_run == 0) Heap::compact();
+#endif
+		}
+		timer.report("allocation/tuples", variant(), tuple_count, "tuple");
+		report_pool();
+#ifdef HEAP_SIZE
+		std::cout << "  heap: " << Heap::size() << " bytes in use" << (Heap::overflowed() ? ", overflowed" : "") << std::endl;
+#endif
+	}
+	
+	// Neighbours joining and leaving a hood of about 64 (the hood arrays grow once, and removals move the last neighbour).
+	{
+		NeighbourHood hood(4);
+		Timer timer;
+		for(unsigned long i = 0; i < neighbour_count; i++){
+			MachineId id = MachineId(next(seed) % (2 * window));
+			NeighbourHood::iterator n = hood.find(id);
+			if (n == hood.end()) hood.add(id);
+			else hood.remove(n);
+		}
+		timer.report("allocation/neighbours", variant(), neighbour_count, "update");
+		report_pool();
+	}
+}
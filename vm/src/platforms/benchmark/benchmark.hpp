@@ -0,0 +1,81 @@
+/*   ____       _  __ _   ____            _
+ *  |  _ \  ___| |/ _| |_|  _ \ _ __ ___ | |_ ___
+ *  | | | |/ _ \ | |_| __| |_) | '__/ _ \| __/ _ \
+ *  | |_| |  __/ |  _| |_|  __/| | ( (_) | |( (_) )
+ *  |____/ \___|_|_|  \__|_|   |_|  \___/ \__\___/
+ *
+ * This file is part of DelftProto.
+ * See COPYING for license details.
+ */
+
+#include <ctime>
+#include <iostream>
+#include <iomanip>
+
+#ifndef __BENCHMARK_HPP
+#define __BENCHMARK_HPP
+
+namespace Benchmark {
+	
+	// A timestamp in processor cycles, or in clock ticks on hosts without a cycle counter.
+	inline unsigned long long cycles() {
+#if defined(__i386__) || defined(__x86_64__)
+		return __builtin_ia32_rdtsc();
+#else
+		return std::clock();
+#endif
+	}
+	
+	// Measures the time and number of cycles between its construction and a call to report().
+	class Timer {
+		
+		protected:
+			unsigned long long start_cycles;
+			std::clock_t start_clock;
+		
+		public:
+			Timer() : start_cycles(cycles()), start_clock(std::clock()) {}
+			
+			// Print a line with the cycles and nanoseconds per operation, and the operations per second.
+			void report(char const * name, char const * variant, unsigned long operations, char const * unit = "op") const {
+				unsigned long long elapsed_cycles = cycles() - start_cycles;
+				double elapsed_seconds = double(std::clock() - start_clock) / CLOCKS_PER_SEC;
+				std::ios_base::fmtflags flags = std::cout.flags();
+				std::streamsize precision = std::cout.precision();
+				std::cout << std::left << std::setw(24) << name << std::setw(16) << variant << std::right << std::fixed
+				          << std::setw(12) << std::setprecision(1) << double(elapsed_cycles) / operations << " cycles/" << unit
+				          << std::setw(12) << std::setprecision(1) << elapsed_seconds * 1e9 / operations << " ns/" << unit
+				          << std::setw(14) << std::setprecision(0) << (elapsed_seconds > 0 ? operations / elapsed_seconds : 0) << ' ' << unit << "/s"
+				          << std::endl;
+				std::cout.flags(flags);
+				std::cout.precision(precision);
+			}
+		
+	};
+	
+	// The name of the configuration this binary was built with, as set by the Makefile.
+	inline char const * variant() {
+#ifdef BENCHMARK_VARIANT
+		return BENCHMARK_VARIANT;
+#else
+		return "default";
+#endif
+	}
+	
+	void rounds();
+	void allocation();
+	void references();
+	void hood();
+	void fold();
+	void reduce();
+	void messages();
+	void gradient();
+	void ingestion();
+	void inbox();
+	void mailbox();
+	void digest();
+	void air();
+	
+}
+
+#endif
@@ -0,0 +1,110 @@
+/*   ____       _  __ _   ____            _
+ *  |  _ \  ___| |/ _| |_|  _ \ _ __ ___ | |_ ___
+ *  | | | |/ _ \ | |_| __| |_) | '__/ _ \| __/ _ \
+ *  | |_| |  __/ |  _| |_|  __/| | ( (_) | |( (_) )
+ *  |____/ \___|_|_|  \__|_|   |_|  \___/ \__\___/
+ *
+ * This file is part of DelftProto.
+ * See COPYING for license details.
+ */
+
+
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+
+#include <instructions.hpp>
+#include <machine.hpp>
+#include <message.hpp>
+
+#include "benchmark.hpp"
+
+#ifdef EXPORT_DIGEST
+
+namespace {
+	using namespace Instructions;
+	
+	// The distance to machine 0, along a path of links that are 0.3 long:
+	// (rep d inf (mux (= (mid) 0) 0 (+ (min-hood (nbr d)) 0.3)))
+	Int8 script[] = { DEF_VM_EX_OP, 16, 8, 2, 1, 1, 1, 4,
+	                  DEF_FUN_2_OP, INF_OP, RET_OP,
+	                  DEF_FUN_OP, 19,
+	                    MID_OP, LIT_0_OP, EQ_OP,
+	                    LIT_0_OP,
+	                    GLO_REF_0_OP, INIT_FEEDBACK_OP, 0,
+	                    HOOD_MIN_OP, 0,
+	                    LIT_FLO_OP, 0x9A, 0x99, 0x99, 0x3E,
+	                    ADD_OP,
+	                    MUX_OP,
+	                    SET_FEEDBACK_OP, 0,
+	                  RET_OP,
+	                  ACTIVATE_OP, 0,
+	                  EXIT_OP };
+	
+	const Number link = Number(0.3);
+	const Size machine_count = 24;
+	const Size round_count = 2000;
+	
+	// Without the digest, every machine broadcasts every round.
+	// With it, a machine only broadcasts when its exports changed, or every heartbeat_interval rounds so that new neighbours hear from it.
+	const Size heartbeat_interval = 16;
+}
+
+#endif
+
+// Runs a gradient on a line of machines that broadcast full messages to the machines next to them,
+// once every round, and then only when their export digest changed (plus a heartbeat), with the digest in the message.
+// Reports the time per round, the messages sent and decoded per round, and the largest error after the last round.
+// Only measured in builds with the export digest.
+void Benchmark::digest(){
+#ifdef EXPORT_DIGEST
+	for(Index mode = 0; mode < 2; mode++){
+		bool digests = mode == 1;
+		Array<Machine> machines(machine_count);
+		for(Index m = 0; m < machine_count; m++){
+			machines[m].id = MachineId(m);
+			machines[m].install(Script(script, sizeof(script)));
+			while(!machines[m].finished()) machines[m].step();
+		}
+		ExportEncoder encoder(machines[0].currentScript());
+		ExportDecoder decoder(machines[0].currentScript());
+		uint32_t broadcast[machine_count];
+		
+		unsigned long sent = 0;
+		unsigned long decoded = 0;
+		Timer timer;
+		for(Size round = 1; round <= round_count; round++){
+			for(Index m = 0; m < machine_count; m++){
+				machines[m].run(Time(round));
+				while(!machines[m].finished()) machines[m].step();
+			}
+			for(Index m = 0; m < machine_count; m++){
+				uint32_t digest = machines[m].exportDigest();
+				if (digests && round > 1 && digest == broadcast[m] && round % heartbeat_interval) continue;
+				broadcast[m] = digest;
+				Int8 buffer[32];
+				Size size = digests ?
+					encoder.encode(machines[m].thisMachine().imports, digest, buffer, sizeof(buffer)) :
+					encoder.encode(machines[m].thisMachine().imports, buffer, sizeof(buffer));
+				sent++;
+				for(Index n = m ? m - 1 : 1; n <= m + 1 && n < machine_count; n += 2){
+					NeighbourHood::iterator neighbour = machines[n].hood.heard(MachineId(m), Time(round));
+					if (!(digests && neighbour->digest_known && neighbour->digest == digest)) decoded++;
+					decoder.decode(machines[n].hood, neighbour, buffer, size);
+				}
+			}
+		}
+		
+		double error = 0;
+		for(Index m = 0; m < machine_count; m++){
+			double e = std::fabs(toDouble(machines[m].threads[0].result.asNumber()) - toDouble(link) * m);
+			if (!(e <= error)) error = e;
+		}
+		char name[32];
+		std::sprintf(name, "digest/%s", digests ? "on" : "off");
+		timer.report(name, variant(), round_count, "round");
+		std::cout << "  " << double(sent) / round_count << " messages sent and " << double(decoded) / round_count << " decoded per round, "
+		          << error << " error" << std::endl;
+	}
+#endif
+}
@@ -0,0 +1,97 @@
+/*   ____       _  __ _   ____            _
+ *  |  _ \  ___| |/ _| |_|  _ \ _ __ ___ | |_ ___
+ *  | | | |/ _ \ | |_| __| |_) | '__/ _ \| __/ _ \
+ *  | |_| |  __/ |  _| |_|  __/| | ( (_) | |( (_) )
+ *  |____/ \___|_|_|  \__|_|   |_|  \___/ \__\___/
+ *
+ * This file is part of DelftProto.
+ * See COPYING for license details.
+ */
+
+#include <cstdio>
+#include <iostream>
+
+#include <instructions.hpp>
+#include <machine.hpp>
+
+#include "benchmark.hpp"
+
+namespace {
+	using namespace Instructions;
+	
+	// A single thread summing the imports of all neighbours every round:
+	// (fold-hood + 0 1)
+	Int8 fold_script[] = { DEF_VM_EX_OP, 16, 8, 2, 1, 0, 1, 4,
+	                       DEF_FUN_4_OP, REF_0_OP, REF_1_OP, ADD_OP, RET_OP,
+	                       DEF_FUN_6_OP,
+	                         GLO_REF_0_OP, LIT_0_OP, LIT_1_OP, FOLD_HOOD_OP, 0,
+	                       RET_OP,
+	                       ACTIVATE_OP, 0,
+	                       EXIT_OP };
+	
+	// The same, using the native instruction:
+	// (hood-sum 1)
+	Int8 sum_script[] = { DEF_VM_EX_OP, 16, 8, 1, 1, 0, 1, 4,
+	                      DEF_FUN_4_OP,
+	                        LIT_1_OP, HOOD_SUM_OP, 0,
+	                      RET_OP,
+	                      ACTIVATE_OP, 0,
+	                      EXIT_OP };
+	
+	struct {
+		char const * name;
+		Int8 * script;
+		Size size;
+	} const scripts[] = {
+		{ "fold", fold_script, sizeof(fold_script) },
+		{ "hood-sum", sum_script, sizeof(sum_script) }
+	};
+
+#ifdef STATIC_MEMORY
+	// Hood sizes that fit in the static block of the benchmark build.
+	const Size hood_sizes[] = { 8, 64 };
+#else
+	const Size hood_sizes[] = { 8, 64, 512 };
+#endif
+	const unsigned long neighbour_rounds = 2000000;
+	
+	// One in this many rounds, the import of one neighbour changes.
+	const unsigned long change_interval = 8;
+	
+	// A small linear congruential generator, to get the same sequence on every platform.
+	inline unsigned long next(unsigned long & seed) {
+		seed = seed * 1103515245ul + 12345ul;
+		return (seed >> 8) & 0xFFFFFF;
+	}
+}
+
+// Measures the rounds of a script that folds the imports of all neighbours, while the imports hardly change,
+// once with FOLD_HOOD and once with the native HOOD_SUM.
+void Benchmark::fold(){
+	for(Index f = 0; f < sizeof(scripts) / sizeof(*scripts); f++){
+		unsigned long seed = 1;
+		for(Index s = 0; s < sizeof(hood_sizes) / sizeof(*hood_sizes); s++){
+			Size hood_size = hood_sizes[s];
+			unsigned long round_count = neighbour_rounds / hood_size;
+			
+			Machine machine;
+			machine.install(Script(scripts[f].script, scripts[f].size));
+			while(!machine.finished()) machine.step();
+			for(Index i = 1; i < hood_size; i++) machine.hood.update(machine.hood.add(MachineId(i)), 0, Number(1));
+			
+			Time time = 0;
+			Timer timer;
+			for(unsigned long i = 0; i < round_count; i++){
+				if (i % change_interval == 0){
+					NeighbourHood::iterator n = machine.hood.find(MachineId(1 + next(seed) % (hood_size - 1)));
+					machine.hood.update(n, 0, Number(next(seed) % 4));
+				}
+				machine.run(time += 1);
+				while(!machine.finished()) machine.step();
+			}
+			char name[32];
+			std::sprintf(name, "%s/%u", scripts[f].name, unsigned(hood_size));
+			timer.report(name, variant(), round_count, "round");
+		}
+	}
+}
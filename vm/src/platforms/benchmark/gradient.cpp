@@ -0,0 +1,139 @@
+/*   ____       _  __ _   ____            _
+ *  |  _ \  ___| |/ _| |_|  _ \ _ __ ___ | |_ ___
+ *  | | | |/ _ \ | |_| __| |_) | '__/ _ \| __/ _ \
+ *  | |_| |  __/ |  _| |_|  __/| | ( (_) | |( (_) )
+ *  |____/ \___|_|_|  \__|_|   |_|  \___/ \__\___/
+ *
+ * This file is part of DelftProto.
+ * See COPYING for license details.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <iomanip>
+
+#include <instructions.hpp>
+#include <machine.hpp>
+#include <message.hpp>
+
+#include "benchmark.hpp"
+
+namespace {
+	using namespace Instructions;
+	
+	// The distance to machine 0, along a path of links that are 0.3 long:
+	// (rep d inf (mux (= (mid) 0) 0 (+ (min-hood (nbr d)) 0.3)))
+	Int8 script[] = { DEF_VM_EX_OP, 16, 8, 2, 1, 1, 1, 4,
+	                  DEF_FUN_2_OP, INF_OP, RET_OP,
+	                  DEF_FUN_OP, 19,
+	                    MID_OP, LIT_0_OP, EQ_OP,
+	                    LIT_0_OP,
+	                    GLO_REF_0_OP, INIT_FEEDBACK_OP, 0,
+	                    HOOD_MIN_OP, 0,
+	                    LIT_FLO_OP, 0x9A, 0x99, 0x99, 0x3E,
+	                    ADD_OP,
+	                    MUX_OP,
+	                    SET_FEEDBACK_OP, 0,
+	                  RET_OP,
+	                  ACTIVATE_OP, 0,
+	                  EXIT_OP };
+	
+	const Number link = Number(0.3);
+
+#ifdef STATIC_MEMORY
+	// A line that fits in the static block of the benchmark build.
+	const Size machine_count = 8;
+#else
+	const Size machine_count = 24;
+#endif
+	const Size round_count = 200;
+	const Size keyframe_interval = 16;
+	
+	// The formats to compare. The distances are at most 0.3 * 23 = 6.9, and infinity before a machine has one.
+	// Every hop rounds again, so with the coarse steps of fixed8 (8/255) the error grows along the line.
+	struct {
+		char const * name;
+		NumberFormat format;
+	} const formats[] = {
+		{ "float32",      NumberFormat() },
+		{ "float16",      NumberFormat(NumberFormat::Encoding_float16) },
+		{ "fixed16",      NumberFormat(NumberFormat::Encoding_fixed16, 0, 8) },
+		{ "fixed8",       NumberFormat(NumberFormat::Encoding_fixed8, 0, 8) },
+		{ "fixed8+band",  NumberFormat(NumberFormat::Encoding_fixed8, 0, 8, Number(0.1)) },
+		{ "float16+band", NumberFormat(NumberFormat::Encoding_float16, 0, 0, Number(0.1)) }
+	};
+}
+
+// Runs a gradient on a line of machines that exchange their exports as (delta) messages every round,
+// with the distance sent in a number of formats. Reports the bytes per message and per keyframe (the largest message),
+// the number of rounds until every machine is (and stays) within 0.1 of its real distance, and the largest error after the last round.
+void Benchmark::gradient(){
+	for(Index f = 0; f < sizeof(formats) / sizeof(*formats); f++){
+		Array<Machine> machines(machine_count);
+		ExportEncoder * encoders[machine_count];
+		ExportDecoder decoder(Script(script, sizeof(script)));
+		decoder.formats(&formats[f].format, 1);
+		char name[32];
+		std::sprintf(name, "gradient/%s", formats[f].name);
+		// An installation that does not fit (in the StaticMemory) leaves the machine without threads.
+		bool installed = true;
+		for(Index m = 0; m < machine_count; m++){
+			machines[m].id = MachineId(m);
+			machines[m].install(Script(script, sizeof(script)));
+			while(!machines[m].finished()) machines[m].step();
+			if (machines[m].threads.size() == 0) installed = false;
+		}
+		for(Index m = 0; m < machine_count; m++){
+			encoders[m] = new ExportEncoder(machines[m].currentScript(), keyframe_interval);
+			encoders[m]->formats(&formats[f].format, 1);
+		}
+		
+		Size messages = 0;
+		Size bytes = 0;
+		Size keyframe = 0;
+		Size converged = 0;
+		double error = 0;
+		for(Size round = 1; installed && round <= round_count; round++){
+			for(Index m = 0; m < machine_count; m++){
+				machines[m].run(Time(round));
+				while(!machines[m].finished()) machines[m].step();
+				// So does a run that runs out of memory.
+				if (machines[m].threads.size() == 0) installed = false;
+			}
+			if (!installed) break;
+			// Every machine broadcasts to the machines next to it.
+			for(Index m = 0; m < machine_count; m++){
+				Int8 buffer[32];
+				Size size = encoders[m]->encode(machines[m].thisMachine().imports, buffer, sizeof(buffer));
+				messages++;
+				bytes += size;
+				if (size > keyframe) keyframe = size;
+				for(Index n = m ? m - 1 : 1; n <= m + 1 && n < machine_count; n += 2){
+					NeighbourHood::iterator neighbour = machines[n].hood.heard(MachineId(m), Time(round));
+					decoder.decode(machines[n].hood, neighbour, buffer, size);
+				}
+			}
+			error = 0;
+			for(Index m = 0; m < machine_count; m++){
+				double e = std::fabs(toDouble(machines[m].threads[0].result.asNumber()) - toDouble(link) * m);
+				if (!(e <= error)) error = e;
+			}
+			if (error > 0.1) converged = 0;
+			else if (!converged) converged = round;
+		}
+		for(Index m = 0; m < machine_count; m++) delete encoders[m];
+		if (!installed){
+			std::cout << std::left << std::setw(24) << name << std::setw(16) << variant() << "not enough memory for " << machine_count << " machines" << std::endl;
+			continue;
+		}
+		
+		std::cout << std::left << std::setw(24) << name << std::setw(16) << variant() << std::right << std::fixed
+		          << std::setw(8) << std::setprecision(2) << double(bytes) / messages << " bytes/message"
+		          << std::setw(4) << keyframe << " bytes/keyframe";
+		if (converged) std::cout << std::setw(6) << converged << " rounds to converge";
+		else std::cout << "   never converges";
+		std::cout
+		          << std::setw(10) << std::setprecision(4) << error << " error" << std::endl;
+	}
+}
@@ -0,0 +1,102 @@
+/*   ____       _  __ _   ____            _
+ *  |  _ \  ___| |/ _| |_|  _ \ _ __ ___ | |_ ___
+ *  | | | |/ _ \ | |_| __| |_) | '__/ _ \| __/ _ \
+ *  | |_| |  __/ |  _| |_|  __/| | ( (_) | |( (_) )
+ *  |____/ \___|_|_|  \__|_|   |_|  \___/ \__\___/
+ *
+ * This file is part of DelftProto.
+ * See COPYING for license details.
+ */
+
+#include <iostream>
+
+#include <machine.hpp>
+
+#include "benchmark.hpp"
+
+namespace {
+	const unsigned long round_count = 1000;
+#ifdef STATIC_MEMORY
+	// A population that fits in the static block of the benchmark build.
+	const Size population = 128;
+#else
+	const Size population = 8192;
+#endif
+	const Size heard_per_round = population / 2;
+	const Time timeout = Time(4);
+	const Size bounded_capacity = 64;
+	const unsigned long message_count = 2000000;
+	const Size export_count = 32;
+	const unsigned long walk_rounds = 200;
+	
+	// A small linear congruential generator, to get the same sequence on every platform.
+	inline unsigned long next(unsigned long & seed) {
+		seed = seed * 1103515245ul + 12345ul;
+		return (seed >> 8) & 0xFFFFFF;
+	}
+}
+
+// Measures the maintenance of large, churning neighbourhoods.
+void Benchmark::hood(){
+	unsigned long seed = 1;
+	
+	// Every round, a random half of the population is heard from, and the ones not heard from for 4 rounds expire.
+	{
+		NeighbourHood hood(4);
+		hood.add(MachineId(-1));
+		unsigned long expired = 0;
+		Timer timer;
+		for(unsigned long round = 0; round < round_count; round++){
+			for(Index i = 0; i < heard_per_round; i++) hood.heard(MachineId(next(seed) % population), Time(round));
+			expired += hood.expire(Time(round), timeout);
+		}
+		timer.report("hood/expiry", variant(), round_count * heard_per_round, "message");
+		std::cout << "  " << hood.size() << " neighbours left, " << expired / round_count << " expired per round" << std::endl;
+	}
+	
+	// Messages from the same population, heard by a hood limited to 64 neighbours, so most messages evict a neighbour.
+	{
+		NeighbourHood hood(4);
+		hood.add(MachineId(-1));
+		hood.limit(bounded_capacity);
+		unsigned long admitted = 0;
+		Timer timer;
+		for(unsigned long i = 0; i < message_count; i++){
+			unsigned long r = next(seed);
+			if (hood.heard(MachineId(r % population), Time(i), Int8(r >> 16)) != hood.end()) admitted++;
+		}
+		timer.report("hood/eviction", variant(), message_count, "message");
+		std::cout << "  " << hood.size() << " neighbours, " << admitted << " messages admitted" << std::endl;
+	}
+	
+	// Every neighbour of the population has a value for the first export, but only for one of the others.
+	{
+#ifdef MEMORY_STATISTICS
+		Size live = MemoryStatistics::of<Data>().live;
+#endif
+		NeighbourHood hood(export_count);
+		hood.add(MachineId(-1));
+		Timer fill_timer;
+		for(Index i = 0; i < population; i++){
+			NeighbourHood::iterator n = hood.add(MachineId(i));
+			hood.update(n, 0, Number(1));
+			hood.update(n, 1 + next(seed) % (export_count - 1), Number(1));
+		}
+		fill_timer.report("hood/sparse-fill", variant(), population * 2, "import");
+#ifdef MEMORY_STATISTICS
+		std::cout << "  " << MemoryStatistics::of<Data>().live - live << " bytes of imports, instead of at least "
+		          << hood.size() * export_count * sizeof(Data) << " for a full matrix" << std::endl;
+#endif
+		
+		// Visit all imports of all exports, as FOLD_HOOD does.
+		unsigned long visited = 0;
+		Timer walk_timer;
+		for(unsigned long round = 0; round < walk_rounds; round++){
+			for(Index k = 0; k < export_count; k++){
+				for(NeighbourHood::iterator n = hood.next(hood.begin(), k); n != hood.end(); n = hood.next(++n, k)) visited++;
+			}
+		}
+		walk_timer.report("hood/sparse-walk", variant(), walk_rounds * export_count, "export");
+		std::cout << "  " << visited / walk_rounds << " imports per round" << std::endl;
+	}
+}
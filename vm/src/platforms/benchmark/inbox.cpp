@@ -0,0 +1,119 @@
+/*   ____       _  __ _   ____            _
+ *  |  _ \  ___| |/ _| |_|  _ \ _ __ ___ | |_ ___
+ *  | | | |/ _ \ | |_| __| |_) | '__/ _ \| __/ _ \
+ *  | |_| |  __/ |  _| |_|  __/| | ( (_) | |( (_) )
+ *  |____/ \___|_|_|  \__|_|   |_|  \___/ \__\___/
+ *
+ * This file is part of DelftProto.
+ * See COPYING for license details.
+ */
+
+#include <cstdio>
+#include <iostream>
+
+#include <instructions.hpp>
+#include <machine.hpp>
+#include <message.hpp>
+
+#include "benchmark.hpp"
+
+#ifdef INBOX_CAPACITY
+
+extern "C" {
+#	include <pthread.h>
+#	include <sched.h>
+}
+
+namespace {
+	using namespace Instructions;
+	
+	// A machine with eight exports and nothing to run.
+	Int8 script[] = { DEF_VM_EX_OP, 4, 4, 0, 0, 0, 8, 1, EXIT_OP };
+	
+	const unsigned long messages_per_producer = 1000000;
+	const Size senders_per_producer = 64;
+	const Size producer_counts[] = { 1, 2, 4 };
+	
+	struct Producer {
+		Machine * machine;
+		Int8 const * message;
+		Size size;
+		Index first_sender;
+		unsigned long full;
+		bool * done;
+	};
+	
+	// Push messages from a number of senders as fast as possible, trying again when the inbox is full.
+	void * produce(void * argument) {
+		Producer & producer = *static_cast<Producer *>(argument);
+		for(unsigned long i = 0; i < messages_per_producer; i++){
+			MachineId from = MachineId(producer.first_sender + i % senders_per_producer);
+			while(!producer.machine->inbox.push(from, producer.message, producer.size)){
+				producer.full++;
+				sched_yield();
+			}
+		}
+		__atomic_store_n(producer.done, true, __ATOMIC_RELEASE);
+		return 0;
+	}
+}
+
+#endif
+
+// Measures threads pushing messages into the inbox of a machine while it runs rounds, which apply the messages at their start.
+// The producers try again (after yielding) when the inbox is full, so this is the rate at which the machine takes messages in.
+// Only measured in builds with an inbox.
+void Benchmark::inbox(){
+#ifdef INBOX_CAPACITY
+	Machine sender;
+	sender.install(Script(script, sizeof(script)));
+	while(!sender.finished()) sender.step();
+	for(Index i = 0; i < 8; i++) sender.hood.update(sender.hood.begin(), i, Number(i * 1.5 + 0.25));
+	ExportEncoder encoder(sender.currentScript());
+	Int8 message[64];
+	Size size = encoder.encode(sender.thisMachine().imports, message, sizeof(message));
+	
+	for(Index p = 0; p < sizeof(producer_counts) / sizeof(*producer_counts); p++){
+		Machine machine;
+		machine.install(Script(script, sizeof(script)));
+		while(!machine.finished()) machine.step();
+		
+		Producer producers[4];
+		bool done[4];
+		pthread_t threads[4];
+		Timer timer;
+		for(Index t = 0; t < producer_counts[p]; t++){
+			Producer producer = { &machine, message, size, 1 + t * senders_per_producer, 0, &done[t] };
+			producers[t] = producer;
+			done[t] = false;
+			pthread_create(&threads[t], 0, produce, &producers[t]);
+		}
+		
+		// Run rounds until all producers are done, and once more for the last messages, letting the producers run in between.
+		unsigned long rounds = 0;
+		unsigned long long run_cycles = 0;
+		for(bool finished = false; !finished; rounds++){
+			finished = true;
+			for(Index t = 0; t < producer_counts[p]; t++) if (!__atomic_load_n(&done[t], __ATOMIC_ACQUIRE)) finished = false;
+			unsigned long long start = cycles();
+			machine.run(Time(rounds));
+			while(!machine.finished()) machine.step();
+			run_cycles += cycles() - start;
+			sched_yield();
+		}
+		
+		unsigned long pushed = 0;
+		unsigned long full = 0;
+		for(Index t = 0; t < producer_counts[p]; t++){
+			pthread_join(threads[t], 0);
+			pushed += messages_per_producer;
+			full += producers[t].full;
+		}
+		char name[32];
+		std::sprintf(name, "inbox/push/%u", unsigned(producer_counts[p]));
+		timer.report(name, variant(), pushed, "message");
+		std::cout << "  " << pushed / rounds << " messages applied per round, " << run_cycles / pushed << " cycles per message in run(), "
+		          << full << " pushes into a full inbox" << std::endl;
+	}
+#endif
+}
@@ -0,0 +1,101 @@
+/*   ____       _  __ _   ____            _
+ *  |  _ \  ___| |/ _| |_|  _ \ _ __ ___ | |_ ___
+ *  | | | |/ _ \ | |_| __| |_) | '__/ _ \| __/ _ \
+ *  | |_| |  __/ |  _| |_|  __/| | ( (_) | |( (_) )
+ *  |____/ \___|_|_|  \__|_|   |_|  \___/ \__\___/
+ *
+ * This file is part of DelftProto.
+ * See COPYING for license details.
+ */
+
+#include <cstdio>
+
+#include <instructions.hpp>
+#include <machine.hpp>
+#include <message.hpp>
+
+#include "benchmark.hpp"
+
+namespace {
+	using namespace Instructions;
+	
+	// A machine with eight exports and nothing to run.
+	Int8 script[] = { DEF_VM_EX_OP, 4, 4, 0, 0, 0, 8, 1, EXIT_OP };
+
+#ifdef STATIC_MEMORY
+	// Batches that fit in the static block of the benchmark build.
+	const Size batch_size = 64;
+#else
+	const Size batch_size = 1000;
+#endif
+	const unsigned long batch_count = 500;
+	
+	// The number of different senders in a batch: every sender once, and every sender ten times.
+	const Size sender_counts[] = { batch_size, batch_size / 10 };
+	
+	// A small linear congruential generator, to get the same sequence on every platform.
+	inline unsigned long next(unsigned long & seed) {
+		seed = seed * 1103515245ul + 12345ul;
+		return (seed >> 8) & 0xFFFFFF;
+	}
+	
+	void start(Machine & machine) {
+		machine.install(Script(script, sizeof(script)));
+		while(!machine.finished()) machine.step();
+	}
+}
+
+// Measures receiving batches of messages, one message at a time (NeighbourHood::heard() and ExportDecoder::decode())
+// and all at once (Machine::receive()), from neighbours that are already known and from neighbours that are all new (after removing all neighbours).
+void Benchmark::ingestion(){
+	Machine sender;
+	start(sender);
+	for(Index i = 0; i < 8; i++) sender.hood.update(sender.hood.begin(), i, Number(i * 1.5 + 0.25));
+	ExportEncoder encoder(sender.currentScript());
+	Int8 buffer[64];
+	Size size = encoder.encode(sender.thisMachine().imports, buffer, sizeof(buffer));
+	
+	NeighbourMessage received[batch_size];
+	
+	for(Index s = 0; s < sizeof(sender_counts) / sizeof(*sender_counts); s++){
+		// The messages of every sender, shuffled.
+		unsigned long seed = 1;
+		for(Index m = 0; m < batch_size; m++){
+			received[m].from = MachineId(1 + m % sender_counts[s]);
+			received[m].data = buffer;
+			received[m].size = size;
+			received[m].signal = 0;
+		}
+		for(Index m = batch_size - 1; m > 0; m--){
+			Index other = next(seed) % (m + 1);
+			NeighbourMessage swap = received[m];
+			received[m] = received[other];
+			received[other] = swap;
+		}
+		
+		for(int fresh = 0; fresh < 2; fresh++){
+			for(int batched = 0; batched < 2; batched++){
+				Machine receiver;
+				start(receiver);
+				ExportDecoder decoder(receiver.currentScript());
+				Size decoded = 0;
+				Timer timer;
+				for(unsigned long b = 0; b < batch_count; b++){
+					if (fresh) while(receiver.hood.size() > 1) receiver.hood.remove(--receiver.hood.end());
+					if (batched){
+						decoded += receiver.receive(received, batch_size, decoder, Time(b));
+					} else {
+						for(Index m = 0; m < batch_size; m++){
+							NeighbourHood::iterator neighbour = receiver.hood.heard(received[m].from, Time(b), received[m].signal);
+							if (neighbour != receiver.hood.end() && decoder.decode(receiver.hood, neighbour, received[m].data, received[m].size)) decoded++;
+						}
+					}
+				}
+				char name[32];
+				std::sprintf(name, "ingest/%s/%s/%u", batched ? "batch" : "each", fresh ? "new" : "known", unsigned(sender_counts[s]));
+				timer.report(name, variant(), batch_count * batch_size, "message");
+				std::cout << "  " << decoded / batch_count << " messages decoded per batch of " << batch_size << std::endl;
+			}
+		}
+	}
+}
@@ -0,0 +1,85 @@
+/*   ____       _  __ _   ____            _
+ *  |  _ \  ___| |/ _| |_|  _ \ _ __ ___ | |_ ___
+ *  | | | |/ _ \ | |_| __| |_) | '__/ _ \| __/ _ \
+ *  | |_| |  __/ |  _| |_|  __/| | ( (_) | |( (_) )
+ *  |____/ \___|_|_|  \__|_|   |_|  \___/ \__\___/
+ *
+ * This file is part of DelftProto.
+ * See COPYING for license details.
+ */
+
+#include <cstdio>
+#include <iostream>
+
+#include <instructions.hpp>
+#include <machine.hpp>
+#include <message.hpp>
+
+#include "benchmark.hpp"
+
+#if defined(INBOX_CAPACITY) && defined(MAILBOX_CAPACITY)
+
+namespace {
+	using namespace Instructions;
+	
+	// A machine with eight exports and nothing to run.
+	Int8 script[] = { DEF_VM_EX_OP, 4, 4, 0, 0, 0, 8, 1, EXIT_OP };
+	
+	const Size neighbour_count = 64;
+	const unsigned long round_count = 5000;
+	
+	// The number of messages every neighbour sends between two rounds. With 128, they do not all fit in the inbox.
+	const Size messages_per_round[] = { 1, 4, 16, 128 };
+	const Size most_messages_per_round = 128;
+	
+	void start(Machine & machine) {
+		machine.install(Script(script, sizeof(script)));
+		while(!machine.finished()) machine.step();
+	}
+}
+
+#endif
+
+// Measures neighbours that send several (full) messages between two rounds, through the inbox and through the mailbox.
+// Both only decode the last message of every neighbour, but the inbox has to hold all of them, and drops the newest ones when it is full.
+// Only measured in builds with both an inbox and a mailbox.
+void Benchmark::mailbox(){
+#if defined(INBOX_CAPACITY) && defined(MAILBOX_CAPACITY)
+	// A series of messages in which the exports keep changing.
+	Machine sender;
+	start(sender);
+	ExportEncoder encoder(sender.currentScript());
+	Int8 messages[most_messages_per_round][64];
+	Size sizes[most_messages_per_round];
+	for(Index m = 0; m < most_messages_per_round; m++){
+		for(Index i = 0; i < 8; i++) sender.hood.update(sender.hood.begin(), i, Number(m * 8 + i));
+		sizes[m] = encoder.encode(sender.thisMachine().imports, messages[m], sizeof(messages[m]));
+	}
+	
+	for(Index k = 0; k < sizeof(messages_per_round) / sizeof(*messages_per_round); k++){
+		for(int use_mailbox = 0; use_mailbox < 2; use_mailbox++){
+			Machine machine;
+			start(machine);
+			unsigned long dropped = 0;
+			Timer timer;
+			for(unsigned long round = 0; round < round_count; round++){
+				for(Index m = 0; m < messages_per_round[k]; m++){
+					for(Index n = 0; n < neighbour_count; n++){
+						bool stored = use_mailbox
+							? machine.mailbox.post(MachineId(n + 1), messages[m], sizes[m])
+							: machine.inbox.push(MachineId(n + 1), messages[m], sizes[m]);
+						if (!stored) dropped++;
+					}
+				}
+				machine.run(Time(round));
+				while(!machine.finished()) machine.step();
+			}
+			char name[32];
+			std::sprintf(name, "%s/%u", use_mailbox ? "mailbox" : "inbox", unsigned(messages_per_round[k]));
+			timer.report(name, variant(), round_count * neighbour_count * messages_per_round[k], "message");
+			timer.report(name, variant(), round_count, "round");
+			std::cout << "  " << dropped / round_count << " messages dropped per round" << std::endl;
+		}
+	}
+#endif
+}
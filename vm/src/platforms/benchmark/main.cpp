@@ -0,0 +1,48 @@
+/*   ____       _  __ _   ____            _
+ *  |  _ \  ___| |/ _| |_|  _ \ _ __ ___ | |_ ___
+ *  | | | |/ _ \ | |_| __| |_) | '__/ _ \| __/ _ \
+ *  | |_| |  __/ |  _| |_|  __/| | ( (_) | |( (_) )
+ *  |____/ \___|_|_|  \__|_|   |_|  \___/ \__\___/
+ *
+ * This file is part of DelftProto.
+ * See COPYING for license details.
+ */
+
+#include <cstring>
+#include <iostream>
+
+#include "benchmark.hpp"
+
+namespace {
+	
+	struct Entry {
+		char const * name;
+		void (*run)();
+	};
+	
+	Entry benchmarks[] = {
+		{ "rounds"    , Benchmark::rounds     },
+		{ "allocation", Benchmark::allocation },
+		{ "references", Benchmark::references },
+		{ "hood"      , Benchmark::hood       },
+		{ "fold"      , Benchmark::fold       },
+		{ "reduce"    , Benchmark::reduce     },
+		{ "messages"  , Benchmark::messages   },
+		{ "gradient"  , Benchmark::gradient   },
+		{ "ingestion" , Benchmark::ingestion  },
+		{ "inbox"     , Benchmark::inbox      },
+		{ "mailbox"   , Benchmark::mailbox    },
+		{ "digest"    , Benchmark::digest     },
+		{ "air"       , Benchmark::air        },
+	};
+	
+}
+
+// Runs all benchmarks, or only those named on the command line.
+int main(int argc, char * argv[]){
+	for(size_t i = 0; i < sizeof(benchmarks) / sizeof(*benchmarks); i++){
+		bool selected = argc < 2;
+		for(int a = 1; a < argc; a++) if (!std::strcmp(argv[a], benchmarks[i].name)) selected = true;
+		if (selected) benchmarks[i].run();
+	}
+}
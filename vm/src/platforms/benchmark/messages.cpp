@@ -0,0 +1,142 @@
+/*   ____       _  __ _   ____            _
+ *  |  _ \  ___| |/ _| |_|  _ \ _ __ ___ | |_ ___
+ *  | | | |/ _ \ | |_| __| |_) | '__/ _ \| __/ _ \
+ *  | |_| |  __/ |  _| |_|  __/| | ( (_) | |( (_) )
+ *  |____/ \___|_|_|  \__|_|   |_|  \___/ \__\___/
+ *
+ * This file is part of DelftProto.
+ * See COPYING for license details.
+ */
+
+#include <cstdio>
+#include <iostream>
+
+#include <instructions.hpp>
+#include <machine.hpp>
+#include <message.hpp>
+
+#include "benchmark.hpp"
+
+namespace {
+	using namespace Instructions;
+	
+	// A machine with eight exports and nothing to run.
+	Int8 script[] = { DEF_VM_EX_OP, 4, 4, 0, 0, 0, 8, 1, EXIT_OP };
+	
+	const unsigned long message_count = 2000000;
+	
+	// The keyframe intervals to compare: only full messages, and deltas with a keyframe every 16 messages.
+	const Size keyframe_intervals[] = { 0, 16 };
+	
+	Data vector(Number x, Number y, Number z) {
+		Tuple tuple(3);
+		tuple.push(x);
+		tuple.push(y);
+		tuple.push(z);
+		return tuple;
+	}
+	
+	// Eight Numbers, such as gradients and distances.
+	void numbers(Machine & machine) {
+		for(Index i = 0; i < 8; i++) machine.hood.update(machine.hood.begin(), i, Number(i * 1.5 + 0.25));
+	}
+	
+	// Four 3D vectors.
+	void vectors(Machine & machine) {
+		for(Index i = 0; i < 4; i++) machine.hood.update(machine.hood.begin(), i, vector(Number(i), Number(0.5), Number(-2)));
+	}
+	
+	// Two Tuples of a Number and two vectors, and two Numbers.
+	Data triple(Number i) {
+		Tuple tuple(3);
+		tuple.push(i);
+		tuple.push(vector(Number(1), Number(2), Number(3)));
+		tuple.push(vector(Number(4), Number(5), Number(6)));
+		return tuple;
+	}
+	
+	void nested(Machine & machine) {
+		for(Index i = 0; i < 2; i++) machine.hood.update(machine.hood.begin(), i, triple(Number(i)));
+		machine.hood.update(machine.hood.begin(), 6, Number(6));
+		machine.hood.update(machine.hood.begin(), 7, Number(7));
+	}
+	
+	struct {
+		char const * name;
+		void (*fill)(Machine &);
+	} const payloads[] = {
+		{ "numbers", numbers },
+		{ "vectors", vectors },
+		{ "nested", nested }
+	};
+	
+	void start(Machine & machine) {
+		machine.install(Script(script, sizeof(script)));
+		while(!machine.finished()) machine.step();
+	}
+}
+
+// Measures encoding the exports of a machine into messages, per message and per byte,
+// and decoding those messages into the imports of a neighbour on another machine.
+// Then measures sending a stream of messages in which one export changes every time, with and without deltas.
+void Benchmark::messages(){
+	for(Index p = 0; p < sizeof(payloads) / sizeof(*payloads); p++){
+		Machine machine;
+		start(machine);
+		payloads[p].fill(machine);
+		
+		ExportEncoder encoder(machine.currentScript());
+		Int8 buffer[256];
+		Size bytes = 0;
+		Timer timer;
+		for(unsigned long i = 0; i < message_count; i++) bytes += encoder.encode(machine.thisMachine().imports, buffer, sizeof(buffer));
+		
+		char name[32];
+		std::sprintf(name, "encode/%s/%u", payloads[p].name, unsigned(bytes / message_count));
+		timer.report(name, variant(), message_count, "message");
+		timer.report(name, variant(), bytes, "byte");
+		
+		Machine receiver;
+		start(receiver);
+		NeighbourHood::iterator neighbour = receiver.hood.add(MachineId(1));
+		
+		ExportDecoder decoder(receiver.currentScript());
+		Size size = encoder.encode(machine.thisMachine().imports, buffer, sizeof(buffer));
+#ifdef MEMORY_STATISTICS
+		MemoryStatistics::Delta delta;
+		delta.begin();
+#endif
+		Timer decode_timer;
+		for(unsigned long i = 0; i < message_count; i++) decoder.decode(receiver.hood, neighbour, buffer, size);
+		std::sprintf(name, "decode/%s/%u", payloads[p].name, unsigned(size));
+		decode_timer.report(name, variant(), message_count, "message");
+#ifdef MEMORY_STATISTICS
+		delta.finish();
+		std::cout << "  " << delta.allocations << " allocations for " << message_count << " messages" << std::endl;
+#endif
+	}
+	
+	for(Index k = 0; k < sizeof(keyframe_intervals) / sizeof(*keyframe_intervals); k++){
+		Machine machine;
+		start(machine);
+		numbers(machine);
+		Machine receiver;
+		start(receiver);
+		NeighbourHood::iterator neighbour = receiver.hood.add(MachineId(1));
+		
+		ExportEncoder encoder(machine.currentScript(), keyframe_intervals[k]);
+		ExportDecoder decoder(receiver.currentScript());
+		Int8 buffer[256];
+		Size bytes = 0;
+		Timer timer;
+		for(unsigned long i = 0; i < message_count; i++){
+			machine.hood.update(machine.hood.begin(), i % 8, Number(i % 1000));
+			Size size = encoder.encode(machine.thisMachine().imports, buffer, sizeof(buffer));
+			decoder.decode(receiver.hood, neighbour, buffer, size);
+			bytes += size;
+		}
+		char name[32];
+		std::sprintf(name, "stream/%s/%u", keyframe_intervals[k] ? "delta" : "full", unsigned(bytes / message_count));
+		timer.report(name, variant(), message_count, "message");
+	}
+}
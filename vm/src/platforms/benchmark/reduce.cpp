@@ -0,0 +1,95 @@
+/*   ____       _  __ _   ____            _
+ *  |  _ \  ___| |/ _| |_|  _ \ _ __ ___ | |_ ___
+ *  | | | |/ _ \ | |_| __| |_) | '__/ _ \| __/ _ \
+ *  | |_| |  __/ |  _| |_|  __/| | ( (_) | |( (_) )
+ *  |____/ \___|_|_|  \__|_|   |_|  \___/ \__\___/
+ *
+ * This file is part of DelftProto.
+ * See COPYING for license details.
+ */
+
+#include <cstdio>
+#include <iostream>
+
+#include <instructions.hpp>
+#include <machine.hpp>
+
+#include "benchmark.hpp"
+
+namespace {
+	using namespace Instructions;
+	
+	// A single thread summing the imports of all neighbours every round with a fuse function:
+	// (fold-hood + 0 1)
+	Int8 fold_script[] = { DEF_VM_EX_OP, 16, 8, 2, 1, 0, 1, 4,
+	                       DEF_FUN_4_OP, REF_0_OP, REF_1_OP, ADD_OP, RET_OP,
+	                       DEF_FUN_6_OP,
+	                         GLO_REF_0_OP, LIT_0_OP, LIT_1_OP, FOLD_HOOD_OP, 0,
+	                       RET_OP,
+	                       ACTIVATE_OP, 0,
+	                       EXIT_OP };
+	
+	// The same with the native instruction:
+	// (hood-sum 1)
+	Int8 sum_script[] = { DEF_VM_EX_OP, 16, 8, 1, 1, 0, 1, 4,
+	                      DEF_FUN_4_OP,
+	                        LIT_1_OP, HOOD_SUM_OP, 0,
+	                      RET_OP,
+	                      ACTIVATE_OP, 0,
+	                      EXIT_OP };
+	
+	// The smallest import:
+	// (hood-min 1)
+	Int8 min_script[] = { DEF_VM_EX_OP, 16, 8, 1, 1, 0, 1, 4,
+	                      DEF_FUN_4_OP,
+	                        LIT_1_OP, HOOD_MIN_OP, 0,
+	                      RET_OP,
+	                      ACTIVATE_OP, 0,
+	                      EXIT_OP };
+	
+	struct {
+		char const * name;
+		Int8 * script;
+		Size size;
+	} const scripts[] = {
+		{ "fold", fold_script, sizeof(fold_script) },
+		{ "sum", sum_script, sizeof(sum_script) },
+		{ "min", min_script, sizeof(min_script) }
+	};
+
+#ifdef STATIC_MEMORY
+	// Hood sizes that fit in the static block of the benchmark build.
+	const Size hood_sizes[] = { 8, 64 };
+#else
+	const Size hood_sizes[] = { 8, 64, 512, 4096, 32768 };
+#endif
+	const unsigned long neighbour_rounds = 4000000;
+}
+
+// Measures the rounds of scripts that reduce the numeric imports of all neighbours, while one import changes every round
+// (so that an incremental FOLD_HOOD can not reuse its result).
+void Benchmark::reduce(){
+	for(Index f = 0; f < sizeof(scripts) / sizeof(*scripts); f++){
+		for(Index s = 0; s < sizeof(hood_sizes) / sizeof(*hood_sizes); s++){
+			Size hood_size = hood_sizes[s];
+			unsigned long round_count = neighbour_rounds / hood_size;
+			
+			Machine machine;
+			machine.install(Script(scripts[f].script, scripts[f].size));
+			while(!machine.finished()) machine.step();
+			for(Index i = 1; i < hood_size; i++) machine.hood.update(machine.hood.add(MachineId(i)), 0, Number(i % 13));
+			
+			Time time = 0;
+			Timer timer;
+			for(unsigned long i = 0; i < round_count; i++){
+				NeighbourHood::iterator n = machine.hood.find(MachineId(1 + i % (hood_size - 1)));
+				machine.hood.update(n, 0, Number(i % 7));
+				machine.run(time += 1);
+				while(!machine.finished()) machine.step();
+			}
+			char name[32];
+			std::sprintf(name, "reduce/%s/%u", scripts[f].name, unsigned(hood_size));
+			timer.report(name, variant(), round_count, "round");
+		}
+	}
+}
@@ -0,0 +1,36 @@
+/*   ____       _  __ _   ____            _
+ *  |  _ \  ___| |/ _| |_|  _ \ _ __ ___ | |_ ___
+ *  | | | |/ _ \ | |_| __| |_) | '__/ _ \| __/ _ \
+ *  | |_| |  __/ |  _| |_|  __/| | ( (_) | |( (_) )
+ *  |____/ \___|_|_|  \__|_|   |_|  \___/ \__\___/
+ *
+ * This file is part of DelftProto.
+ * See COPYING for license details.
+ */
+
+#include <machine.hpp>
+
+#include "benchmark.hpp"
+
+namespace {
+	const unsigned long copy_count = 10000000;
+	const Size window = 64;
+	
+	Data triple() {
+		Tuple tuple(3);
+		tuple.push(Number(1));
+		tuple.push(Number(2));
+		tuple.push(Number(3));
+		return tuple;
+	}
+}
+
+// Measures the cost of sharing tuples: every copy of a Data holding a tuple adds a reference, and overwriting it removes one.
+void Benchmark::references(){
+	Data data = triple();
+	
+	Array<Data> copies(window);
+	Timer timer;
+	for(unsigned long i = 0; i < copy_count; i++) copies[i % window] = data;
+	timer.report("references", variant(), copy_count, "copy");
+}
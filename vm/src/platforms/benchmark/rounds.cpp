@@ -0,0 +1,73 @@
+/*   ____       _  __ _   ____            _
+ *  |  _ \  ___| |/ _| |_|  _ \ _ __ ___ | |_ ___
+ *  | | | |/ _ \ | |_| __| |_) | '__/ _ \| __/ _ \
+ *  | |_| |  __/ |  _| |_|  __/| | ( (_) | |( (_) )
+ *  |____/ \___|_|_|  \__|_|   |_|  \___/ \__\___/
+ *
+ * This file is part of DelftProto.
+ * See COPYING for license details.
+ */
+
+#include <iostream>
+
+#include <instructions.hpp>
+#include <machine.hpp>
+
+#include "benchmark.hpp"
+
+namespace {
+	using namespace Instructions;
+	
+	// A single thread doing some scalar and vector math every round:
+	// (+ (sin (atan2 1.5 2.25)) (sqrt (* 0.75 3)) (abs (* (tup 1 2 3) 2)))
+	Int8 script[] = { DEF_VM_EX_OP, 16, 8, 1, 1, 0, 1, 4,
+	                  DEF_FUN_OP, 31,
+	                    LIT_FLO_OP, 0x00, 0x00, 0xC0, 0x3F,
+	                    LIT_FLO_OP, 0x00, 0x00, 0x10, 0x40,
+	                    ATAN2_OP,
+	                    SIN_OP,
+	                    LIT_FLO_OP, 0x00, 0x00, 0x40, 0x3F,
+	                    LIT_3_OP,
+	                    MUL_OP,
+	                    SQRT_OP,
+	                    ADD_OP,
+	                    LIT_1_OP, LIT_2_OP, LIT_3_OP, FAB_TUP_OP, 3,
+	                    LIT_2_OP,
+	                    MUL_OP,
+	                    ABS_OP,
+	                    ADD_OP,
+	                  RET_OP,
+	                  ACTIVATE_OP, 0,
+	                  EXIT_OP };
+	
+	const unsigned long round_count = 200000;
+}
+
+// Measures the time needed for a single Machine::run() of a math heavy script.
+void Benchmark::rounds(){
+	Machine machine;
+	machine.install(Script(script, sizeof(script)));
+	while(!machine.finished()) machine.step();
+	
+	Time time = 0;
+	Timer timer;
+	for(unsigned long i = 0; i < round_count; i++){
+		machine.run(time += 1);
+		while(!machine.finished()) machine.step();
+	}
+	timer.report("rounds", variant(), round_count, "round");
+	
+	std::cout << "  result: " << toDouble(machine.threads[0].result.asNumber()) << std::endl;
+	
+#ifdef MEMORY_STATISTICS
+	MemoryStatistics::Delta const & run = machine.lastRunMemoryUsage();
+	std::cout << "  last run: " << run.allocations << " allocations, " << run.deallocations << " deallocations, "
+	          << run.start << " -> " << run.end << " bytes, peak " << run.peak << " bytes" << std::endl;
+	for(MemoryStatistics::Counters const * c = Machine::memoryUsageByType(); c; c = c->next){
+		std::cout << "  ";
+		std::cout.write(c->name, c->name_length);
+		std::cout << ": " << c->live << " bytes, peak " << c->peak << " bytes, "
+		          << c->allocations << " allocations, " << c->deallocations << " deallocations" << std::endl;
+	}
+#endif
+}
@@ -19,16 +19,38 @@ extern "C" {
 
 inline void * operator new (Size size, void * memory) { return memory; }
 
+#if defined(POOL_MEMORY) || defined(STATIC_MEMORY)
+#include <pool.hpp>
+#endif
+
+#ifdef MEMORY_STATISTICS
+#include <memorystatistics.hpp>
+#endif
+
 template<typename Element>
 class Memory {
 	public:
 		
 		static Element * allocate(Size capacity = 1) {
+#ifdef MEMORY_STATISTICS
+			MemoryStatistics::allocated<Element>(capacity);
+#endif
+#if defined(POOL_MEMORY) || defined(STATIC_MEMORY)
+			return PoolMemory<Element>::allocate(capacity);
+#else
 			return static_cast<Element *>(malloc(capacity * sizeof(Element)));
+#endif
 		}
 		
 		static void deallocate(Element * memory, Size capacity = 1) {
+#ifdef MEMORY_STATISTICS
+			if (memory) MemoryStatistics::deallocated<Element>(capacity);
+#endif
+#if defined(POOL_MEMORY) || defined(STATIC_MEMORY)
+			PoolMemory<Element>::deallocate(memory, capacity);
+#else
 			free(static_cast<void *>(memory));
+#endif
 		}
 		
 };
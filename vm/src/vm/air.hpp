@@ -0,0 +1,205 @@
+/*   ____       _  __ _   ____            _
+ *  |  _ \  ___| |/ _| |_|  _ \ _ __ ___ | |_ ___
+ *  | | | |/ _ \ | |_| __| |_) | '__/ _ \| __/ _ \
+ *  | |_| |  __/ |  _| |_|  __/| | ( (_) | |( (_) )
+ *  |____/ \___|_|_|  \__|_|   |_|  \___/ \__\___/
+ *
+ * This file is part of DelftProto.
+ * See COPYING for license details.
+ */
+
+
+/// \file
+/// Provides the Air class.
+
+#ifndef __AIR_HPP
+#define __AIR_HPP
+
+extern "C" {
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+}
+
+#include <types.hpp>
+#include <machineid.hpp>
+
+/** \cond */
+#ifndef AIR_MESSAGE_SIZE
+#define AIR_MESSAGE_SIZE 128
+#endif
+/** \endcond */
+
+/// A region of shared memory in which emulated devices, each in a process of its own, broadcast their messages.
+/**
+ * This is a transport for running many machines on one POSIX host, such as to load-test a topology:
+ * every device owns a slot, in which it publishes its newest message (as encoded by its ExportEncoder),
+ * and reads the slots of the devices it can hear directly, without sockets or system calls.
+ * 
+ * The region is a file (such as one in /dev/shm) that is mapped into every process:
+ * a header with the number of slots and \c AIR_MESSAGE_SIZE (128 by default), followed by the slots, each on cache lines of their own.
+ * A slot only keeps the newest message, so the devices should send full messages only (see Mailbox).
+ * 
+ * Every slot has a sequence number, which is odd while its device is writing a message and increases by two for every message (a seqlock).
+ * Only the device that owns a slot writes to it, so publish() never waits.
+ * read() copies a message, and only uses it when the sequence number was the same (and even) before and after copying.
+ * Otherwise the message is being overwritten, and the newer one is read next time.
+ * 
+ * \code
+ * Air air("/dev/shm/air", 0); // Join the region that was created by the launcher.
+ * air.publish(index, machine.id, message, encoder.encode(machine.thisMachine().imports, message, sizeof(message)));
+ * Size size = air.read(neighbour_index, last_sequence, from, message);
+ * if (size) decoder.decode(machine.hood, machine.hood.heard(from, now), message, size);
+ * \endcode
+ * 
+ * \note Only available on POSIX hosts.
+ */
+class Air {
+	
+	protected:
+		
+		struct Header {
+			Size magic;
+			Size capacity;
+			Size message_size;
+		};
+		
+		struct Slot {
+			Size sequence;
+			MachineId from;
+			Size size;
+			Size words[(AIR_MESSAGE_SIZE + sizeof(Size) - 1) / sizeof(Size)]; // The message, copied a word at a time.
+		};
+		
+		// The number of bytes a slot or the header takes: a whole number of cache lines.
+		static inline Size stride(Size bytes) {
+			return (bytes + 63) / 64 * 64;
+		}
+		
+		static const Size magic = 0x41697221; // "Air!"
+		
+		int file;
+		Int8 * memory;
+		Size length;
+		Size capacity;
+		
+		inline Slot & slot(Index index) const {
+			return *reinterpret_cast<Slot *>(memory + stride(sizeof(Header)) + index * stride(sizeof(Slot)));
+		}
+	
+	private:
+		Air(Air const &);
+		Air & operator = (Air const &);
+	
+	public:
+		/// Create a region, or join an existing one.
+		/**
+		 * \param path The file that holds the region, such as one in /dev/shm.
+		 * \param capacity The number of slots of a new region, which replaces any region in the file, or zero to join the region in the file.
+		 * 
+		 * \see valid() to check whether this worked.
+		 */
+		inline Air(char const * path, Size capacity) : memory(0), length(0), capacity(0) {
+			file = open(path, O_RDWR | (capacity ? O_CREAT | O_TRUNC : 0), 0600);
+			if (file < 0) return;
+			if (capacity){
+				length = stride(sizeof(Header)) + capacity * stride(sizeof(Slot));
+				if (ftruncate(file, length) != 0) return;
+			} else {
+				struct stat status;
+				if (fstat(file, &status) != 0 || Size(status.st_size) < stride(sizeof(Header))) return;
+				length = status.st_size;
+			}
+			void * mapping = mmap(0, length, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+			if (mapping == MAP_FAILED) return;
+			memory = static_cast<Int8 *>(mapping);
+			Header & header = *reinterpret_cast<Header *>(memory);
+			if (capacity){
+				header.capacity = capacity;
+				header.message_size = AIR_MESSAGE_SIZE;
+				__atomic_store_n(&header.magic, magic, __ATOMIC_RELEASE);
+			} else if (__atomic_load_n(&header.magic, __ATOMIC_ACQUIRE) != magic || header.message_size != AIR_MESSAGE_SIZE ||
+			           length < stride(sizeof(Header)) + header.capacity * stride(sizeof(Slot))){
+				return;
+			}
+			this->capacity = header.capacity;
+		}
+		
+		/// The destructor, which unmaps the region but leaves the file (see remove()).
+		inline ~Air() {
+			if (memory) munmap(memory, length);
+			if (file >= 0) close(file);
+		}
+		
+		/// Remove the file of a region. Processes that joined it can keep using it.
+		static inline bool remove(char const * path) {
+			return unlink(path) == 0;
+		}
+		
+		/// Check whether the region was created or joined (true) or not (false), such as when the file does not exist, or was made with another \c AIR_MESSAGE_SIZE.
+		inline bool valid() const {
+			return capacity;
+		}
+		
+		/// The number of slots.
+		inline Size size() const {
+			return capacity;
+		}
+		
+		/// Replace the message in a slot. Only for the device that owns the slot.
+		/**
+		 * \param index The slot.
+		 * \param from The ID of the device.
+		 * \param data The message, as encoded by its ExportEncoder. It is copied.
+		 * \param size The length of the message in bytes.
+		 * \return Whether the message was stored. If not, it was larger than \c AIR_MESSAGE_SIZE (or empty).
+		 */
+		inline bool publish(Index index, MachineId const & from, Int8 const * data, Size size) {
+			if (!size || size > AIR_MESSAGE_SIZE) return false;
+			Slot & s = slot(index);
+			Size sequence = __atomic_load_n(&s.sequence, __ATOMIC_RELAXED);
+			__atomic_store_n(&s.sequence, sequence + 1, __ATOMIC_RELAXED);
+			__atomic_thread_fence(__ATOMIC_RELEASE);
+			MachineId id = from;
+			__atomic_store(&s.from, &id, __ATOMIC_RELAXED);
+			__atomic_store_n(&s.size, size, __ATOMIC_RELAXED);
+			for(Index w = 0; w * sizeof(Size) < size; w++){
+				Size word = 0;
+				Size bytes = size - w * sizeof(Size) < sizeof(Size) ? size - w * sizeof(Size) : sizeof(Size);
+				for(Index b = 0; b < bytes; b++) reinterpret_cast<Int8 *>(&word)[b] = data[w * sizeof(Size) + b];
+				__atomic_store_n(&s.words[w], word, __ATOMIC_RELAXED);
+			}
+			__atomic_store_n(&s.sequence, sequence + 2, __ATOMIC_RELEASE);
+			return true;
+		}
+		
+		/// Copy the message in a slot, when there is a newer one than the one that was read last.
+		/**
+		 * \param index The slot.
+		 * \param sequence The sequence number of the message that was read last from this slot, which starts at zero and is updated by this function.
+		 * \param from Set to the ID of the device that sent the message.
+		 * \param buffer Where to copy the message, which must have room for \c AIR_MESSAGE_SIZE bytes.
+		 * \return The size of the message, or zero when there is no newer message, or it was being overwritten.
+		 */
+		inline Size read(Index index, Size & sequence, MachineId & from, Int8 * buffer) const {
+			Slot & s = slot(index);
+			Size begin = __atomic_load_n(&s.sequence, __ATOMIC_ACQUIRE);
+			if (begin == sequence || (begin & 1)) return 0;
+			MachineId id;
+			__atomic_load(&s.from, &id, __ATOMIC_RELAXED);
+			Size size = __atomic_load_n(&s.size, __ATOMIC_RELAXED);
+			if (!size || size > AIR_MESSAGE_SIZE) return 0;
+			Size words[(AIR_MESSAGE_SIZE + sizeof(Size) - 1) / sizeof(Size)];
+			for(Index w = 0; w * sizeof(Size) < size; w++) words[w] = __atomic_load_n(&s.words[w], __ATOMIC_RELAXED);
+			__atomic_thread_fence(__ATOMIC_ACQUIRE);
+			if (__atomic_load_n(&s.sequence, __ATOMIC_RELAXED) != begin) return 0;
+			for(Index i = 0; i < size; i++) buffer[i] = reinterpret_cast<Int8 const *>(words)[i];
+			sequence = begin;
+			from = id;
+			return size;
+		}
+	
+};
+
+#endif
@@ -14,8 +14,13 @@
 #ifndef __DATA_HPP
 #define __DATA_HPP
 
+extern "C" {
+#	include <stdint.h>
+}
+
 #include <memory.hpp>
 #include <types.hpp>
+#include <number.hpp>
 #include <tuple.hpp>
 #include <address.hpp>
 #include <stack.hpp>
@@ -56,6 +61,13 @@ class Data {
 			char address_data[sizeof(Address)];
 		} value;
 		
+		// Mix bytes into an FNV-1a hash.
+		static inline uint32_t hash(uint32_t hash, void const * data, Size size) {
+			Int8 const * bytes = static_cast<Int8 const *>(data);
+			for(Index i = 0; i < size; i++) hash = (hash ^ bytes[i]) * 16777619u;
+			return hash;
+		}
+		
 	public:
 		
 		inline Data(                       ) : value_type(Type_undefined) {                                } ///< Get a Data object representing 'undefined' (ie. 'not set').
@@ -63,6 +75,15 @@ class Data {
 		inline Data(Tuple   const & tuple  ) : value_type(Type_tuple    ) { new (&value) Tuple  (tuple  ); } ///< Get a Data object containing a Tuple.
 		inline Data(Address const & address) : value_type(Type_address  ) { new (&value) Address(address); } ///< Get a Data object containing an Address.
 		
+#ifdef FIXED_POINT_NUMBER
+		/// Get a Data object containing a Number, converted from any other numeric type.
+		/**
+		 * This makes something like \code machine.stack.push(1); \endcode work when Number is not a built-in type.
+		 */
+		template<typename Numeric>
+		inline Data(Numeric const & number) : value_type(Type_number) { new (&value) Number(number); }
+#endif
+		
 		/// Copy a Data object.
 		inline Data & operator = (Data const & data) {
 			switch(data.type()){
@@ -123,6 +144,77 @@ class Data {
 			return *this;
 		}
 		
+		/// Check whether this has the same type and value as another Data object.
+		/**
+		 * Tuples are compared element by element, unless they share their contents.
+		 */
+		inline bool identical(Data const & data) const {
+			if (value_type != data.value_type) return false;
+			switch(value_type){
+				case Type_undefined: return true;
+				case Type_number   : return asNumber () == data.asNumber ();
+				case Type_address  : return asAddress() == data.asAddress();
+				case Type_tuple    : break;
+			}
+			Tuple const & a = asTuple();
+			Tuple const & b = data.asTuple();
+			if (a.size() != b.size()) return false;
+			Data const * x = a;
+			Data const * y = b;
+			if (x == y) return true;
+			for(Index i = 0; i < a.size(); i++) if (!x[i].identical(y[i])) return false;
+			return true;
+		}
+		
+		/// A hash of the type and value, which is the same for Data objects that are identical().
+		/**
+		 * An Address is hashed as a pointer, so the hash is only meaningful on the machine that computed it.
+		 */
+		inline uint32_t hash() const {
+			Int8 type = Int8(value_type);
+			uint32_t h = hash(2166136261u, &type, 1);
+			switch(value_type){
+				case Type_undefined: return h;
+				case Type_number   : {
+					Number number = asNumber();
+					if (number == Number(0)) number = Number(0); // Zero and negative zero are identical.
+					return hash(h, &number, sizeof(number));
+				}
+				case Type_address  : {
+					Int8 const * address = asAddress();
+					return hash(h, &address, sizeof(address));
+				}
+				case Type_tuple    : break;
+			}
+			Tuple const & tuple = asTuple();
+			Size size = tuple.size();
+			h = hash(h, &size, sizeof(size));
+			for(Index i = 0; i < size; i++){
+				uint32_t element = tuple[i].hash();
+				h = hash(h, &element, sizeof(element));
+			}
+			return h;
+		}
+		
+#ifdef ROUND_REGION_SIZE
+		/// Move a Tuple (and the Tuples it contains) out of any Region.
+		/**
+		 * The Tuples in a Region are copied to memory allocated by Memory.
+		 * 
+		 * \warning There should be no active Region while doing this.
+		 * 
+		 * \param all Also look for Tuples in a Region inside Tuples that are not in a Region themselves.
+		 *            This is only needed when a Region overflowed, because only then Tuples created during a run can end up outside the Region.
+		 */
+		inline void promote(bool all = false) {
+			if (value_type != Type_tuple) return;
+			if (asTuple().temporary()) reset(asTuple().copy());
+			else if (!all) return;
+			Tuple & tuple = asTuple();
+			for(Index i = 0; i < tuple.size(); i++) tuple[i].promote(all);
+		}
+#endif
+		
 		/// Deconstruct the data.
 		inline ~Data() {
 			reset();
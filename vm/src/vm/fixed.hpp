@@ -0,0 +1,361 @@
+/*   ____       _  __ _   ____            _
+ *  |  _ \  ___| |/ _| |_|  _ \ _ __ ___ | |_ ___
+ *  | | | |/ _ \ | |_| __| |_) | '__/ _ \| __/ _ \
+ *  | |_| |  __/ |  _| |_|  __/| | ( (_) | |( (_) )
+ *  |____/ \___|_|_|  \__|_|   |_|  \___/ \__\___/
+ *
+ * This file is part of DelftProto.
+ * See COPYING for license details.
+ */
+
+/// \file
+/// Provides the Fixed class and the fixed point math functions.
+
+#include <stdint.h>
+
+#ifndef __FIXED_HPP
+#define __FIXED_HPP
+
+/// A saturating fixed point number.
+/**
+ * Used as Number on platforms without a floating point unit,
+ * by defining \c FIXED_POINT_NUMBER to the number of fractional bits (usually 16).
+ *
+ * All arithmetic is done with integer instructions only.
+ * Results that do not fit are saturated, and the largest representable value is used as infinity.
+ * Division by zero gives (signed) infinity.
+ *
+ * \note Only named conversions to the built-in types are provided (toInt(), toFloat() and toDouble()),
+ *       to keep mixed expressions such as <tt>a + 1</tt> unambiguous without the explicit conversion operators of C++11.
+ *       See toInteger() and toDouble() for conversions that work for any Number.
+ *
+ * \tparam fraction_bits The number of fractional bits.
+ */
+template<int fraction_bits = 16>
+class Fixed {
+	
+	public:
+		/// The underlying integer representation.
+		typedef int32_t Raw;
+		
+		/// The number of fractional bits.
+		static const int fraction = fraction_bits;
+	
+	protected:
+		Raw raw;
+		
+		static const Raw one = Raw(1) << fraction_bits;
+		static const Raw max = 0x7FFFFFFF;
+		
+		static inline Raw saturate(int64_t value) {
+			return value > max ? max : value < -max ? -max : Raw(value);
+		}
+		
+		static inline Raw fromDouble(double value) {
+			value *= one;
+			return value >= max ? max : value <= -max ? -max : Raw(value < 0 ? value - 0.5 : value + 0.5);
+		}
+		
+		// Shift left without the undefined behaviour of shifting a negative number.
+		static inline int64_t scale(int64_t value) {
+			return value * (int64_t(1) << fraction_bits);
+		}
+	
+	public:
+		inline Fixed(                           ) : raw(0) {}
+		inline Fixed(int                   value) : raw(saturate(scale(value))) {}
+		inline Fixed(unsigned int          value) : raw(saturate(scale(value))) {}
+		inline Fixed(long                  value) : raw(value > max || value < -max ? (value < 0 ? -max : max) : saturate(scale(value))) {}
+		inline Fixed(unsigned long         value) : raw(value > uint64_t(max) ? max : saturate(scale(value))) {}
+		inline Fixed(long long             value) : raw(value > max || value < -max ? (value < 0 ? -max : max) : saturate(scale(value))) {}
+		inline Fixed(unsigned long long    value) : raw(value > uint64_t(max) ? max : saturate(scale(value))) {}
+		inline Fixed(float                 value) : raw(fromDouble(value)) {}
+		inline Fixed(double                value) : raw(fromDouble(value)) {}
+		
+		/// Construct a Fixed from its raw integer representation.
+		static inline Fixed fromRaw(Raw raw) { Fixed f; f.raw = raw; return f; }
+		
+		/// Get the raw integer representation.
+		inline Raw toRaw() const { return raw; }
+		
+		/// The value used to represent infinity: the largest representable number.
+		static inline Fixed infinity() { return fromRaw(max); }
+		
+		/// Convert to an integer, truncating towards zero like the conversion of a \c float does.
+		inline Raw toInt() const { return raw / one; }
+		
+		/// Convert to a \c float.
+		inline float toFloat() const { return float(raw) / one; }
+		
+		/// Convert to a \c double.
+		inline double toDouble() const { return double(raw) / one; }
+		
+		/// Check whether the number is zero.
+		inline bool isZero() const { return raw == 0; }
+		
+		inline Fixed operator + () const { return *this; }
+		inline Fixed operator - () const { return fromRaw(-raw); }
+		
+		inline friend Fixed operator + (Fixed a, Fixed b) { return fromRaw(saturate(int64_t(a.raw) + b.raw)); }
+		inline friend Fixed operator - (Fixed a, Fixed b) { return fromRaw(saturate(int64_t(a.raw) - b.raw)); }
+		inline friend Fixed operator * (Fixed a, Fixed b) { return fromRaw(saturate((int64_t(a.raw) * b.raw) >> fraction_bits)); }
+		inline friend Fixed operator / (Fixed a, Fixed b) {
+			if (!b.raw) return fromRaw(a.raw < 0 ? -max : max);
+			return fromRaw(saturate(scale(a.raw) / b.raw));
+		}
+		
+		inline Fixed & operator += (Fixed b) { return *this = *this + b; }
+		inline Fixed & operator -= (Fixed b) { return *this = *this - b; }
+		inline Fixed & operator *= (Fixed b) { return *this = *this * b; }
+		inline Fixed & operator /= (Fixed b) { return *this = *this / b; }
+		
+		inline Fixed & operator ++ (     ) { return *this += 1; }
+		inline Fixed & operator -- (     ) { return *this -= 1; }
+		inline Fixed   operator ++ (int x) { Fixed f = *this; *this += 1; return f; }
+		inline Fixed   operator -- (int x) { Fixed f = *this; *this -= 1; return f; }
+		
+		inline friend bool operator == (Fixed a, Fixed b) { return a.raw == b.raw; }
+		inline friend bool operator != (Fixed a, Fixed b) { return a.raw != b.raw; }
+		inline friend bool operator <  (Fixed a, Fixed b) { return a.raw <  b.raw; }
+		inline friend bool operator <= (Fixed a, Fixed b) { return a.raw <= b.raw; }
+		inline friend bool operator >  (Fixed a, Fixed b) { return a.raw >  b.raw; }
+		inline friend bool operator >= (Fixed a, Fixed b) { return a.raw >= b.raw; }
+	
+};
+
+/** \cond */
+namespace FixedMath {
+	
+	// The kernels below work on values with 30 fractional bits.
+	const int precision = 30;
+	
+	const int64_t unit      = int64_t(1) << precision;
+	const int64_t pi        = 3373259426LL;
+	const int64_t half_pi   = pi / 2;
+	const int64_t two_pi    = pi * 2;
+	const int64_t ln2       = 744261118LL;
+	const int32_t gain      = 652032874; // The inverse CORDIC gain.
+	
+	const int cordic_steps = 24;
+	
+	const int32_t arctangents[cordic_steps] = {
+		843314857, 497837829, 263043837, 133525159, 67021687, 33543516, 16775851, 8388437,
+		4194283, 2097149, 1048576, 524288, 262144, 131072, 65536, 32768,
+		16384, 8192, 4096, 2048, 1024, 512, 256, 128
+	};
+	
+	template<int f> inline int64_t widen(Fixed<f> x) {
+		return int64_t(x.toRaw()) * (int64_t(1) << (precision - f));
+	}
+	
+	template<int f> inline Fixed<f> narrow(int64_t x) {
+		int64_t rounded = (x + (int64_t(1) << (precision - f - 1))) >> (precision - f);
+		return Fixed<f>::fromRaw(rounded > 0x7FFFFFFF ? 0x7FFFFFFF : rounded < -0x7FFFFFFF ? -0x7FFFFFFF : int32_t(rounded));
+	}
+	
+	inline int64_t multiply(int64_t a, int64_t b) {
+		return (a * b) >> precision;
+	}
+	
+	inline int highestBit(uint64_t x) {
+		int bit = -1;
+		while(x){ x >>= 1; bit++; }
+		return bit;
+	}
+	
+	// Rotate (unit,0) over an angle in [-pi/2, pi/2].
+	inline void rotate(int64_t angle, int64_t & cos, int64_t & sin) {
+		int64_t x = gain, y = 0, z = angle;
+		for(int i = 0; i < cordic_steps; i++){
+			int64_t x_next;
+			if (z >= 0){ x_next = x - (y >> i); y += x >> i; z -= arctangents[i]; }
+			else       { x_next = x + (y >> i); y -= x >> i; z += arctangents[i]; }
+			x = x_next;
+		}
+		cos = x;
+		sin = y;
+	}
+	
+	// Sine and cosine of any angle.
+	inline void sincos(int64_t angle, int64_t & cos, int64_t & sin) {
+		angle %= two_pi;
+		if (angle >  pi) angle -= two_pi;
+		if (angle < -pi) angle += two_pi;
+		bool mirror = false;
+		if      (angle >  half_pi) { angle =  pi - angle; mirror = true; }
+		else if (angle < -half_pi) { angle = -pi - angle; mirror = true; }
+		rotate(angle, cos, sin);
+		if (mirror) cos = -cos;
+	}
+	
+	// The angle of the vector (x,y) in [-pi, pi].
+	inline int64_t angle(int64_t y, int64_t x) {
+		if (!x && !y) return 0;
+		int64_t base = 0;
+		if (x < 0){
+			base = y < 0 ? -pi : pi;
+			x = -x;
+			y = -y;
+		}
+		int shift = highestBit(x > (y < 0 ? -y : y) ? x : (y < 0 ? -y : y)) - (precision - 1);
+		if (shift > 0){ x >>= shift; y >>= shift; }
+		else          { x *= int64_t(1) << -shift; y *= int64_t(1) << -shift; }
+		int64_t z = 0;
+		for(int i = 0; i < cordic_steps; i++){
+			int64_t x_next;
+			if (y > 0){ x_next = x + (y >> i); y -= x >> i; z += arctangents[i]; }
+			else      { x_next = x - (y >> i); y += x >> i; z -= arctangents[i]; }
+			x = x_next;
+		}
+		return base + z;
+	}
+	
+	// e^x for x in [0, ln2).
+	inline int64_t exponent(int64_t x) {
+		int64_t e = unit;
+		for(int i = 10; i > 0; i--) e = unit + multiply(x, e) / i;
+		return e;
+	}
+	
+	// ln(x) for x in [1, 2).
+	inline int64_t logarithm(int64_t x) {
+		int64_t s  = ((x - unit) << precision) / (x + unit);
+		int64_t s2 = multiply(s, s);
+		int64_t sum = 0;
+		for(int i = 9; i > 1; i -= 2) sum = multiply(s2, unit / i + sum);
+		return 2 * multiply(s, unit + sum);
+	}
+	
+}
+/** \endcond */
+
+/// \name Fixed point math functions
+/// These match the functions of the standard \c cmath header, so that the math instructions work on Fixed numbers as well.
+/// \{
+
+template<int f> inline Fixed<f> fabs(Fixed<f> x) { return x < 0 ? -x : x; }
+
+template<int f> inline Fixed<f> floor(Fixed<f> x) {
+	return Fixed<f>::fromRaw(x.toRaw() & ~((int32_t(1) << f) - 1));
+}
+
+template<int f> inline Fixed<f> ceil(Fixed<f> x) {
+	return -floor(-x);
+}
+
+/// Round to the nearest integer, with halfway cases rounded up.
+template<int f> inline Fixed<f> rint(Fixed<f> x) {
+	return floor(x + Fixed<f>::fromRaw(int32_t(1) << (f - 1)));
+}
+
+template<int f> inline Fixed<f> fmod(Fixed<f> a, Fixed<f> b) {
+	if (!b.toRaw()) return 0;
+	return Fixed<f>::fromRaw(a.toRaw() % b.toRaw());
+}
+
+template<int f> inline Fixed<f> sqrt(Fixed<f> x) {
+	if (x.toRaw() <= 0) return 0;
+	uint64_t value = uint64_t(x.toRaw()) << f;
+	uint64_t root = 0;
+	uint64_t bit = uint64_t(1) << 62;
+	while(bit > value) bit >>= 2;
+	while(bit){
+		if (value >= root + bit){
+			value -= root + bit;
+			root = (root >> 1) + bit;
+		} else {
+			root >>= 1;
+		}
+		bit >>= 2;
+	}
+	return Fixed<f>::fromRaw(int32_t(root));
+}
+
+template<int f> inline Fixed<f> sin(Fixed<f> x) {
+	int64_t c, s;
+	FixedMath::sincos(FixedMath::widen(x), c, s);
+	return FixedMath::narrow<f>(s);
+}
+
+template<int f> inline Fixed<f> cos(Fixed<f> x) {
+	int64_t c, s;
+	FixedMath::sincos(FixedMath::widen(x), c, s);
+	return FixedMath::narrow<f>(c);
+}
+
+template<int f> inline Fixed<f> tan(Fixed<f> x) {
+	int64_t c, s;
+	FixedMath::sincos(FixedMath::widen(x), c, s);
+	return FixedMath::narrow<f>(s) / FixedMath::narrow<f>(c);
+}
+
+template<int f> inline Fixed<f> atan2(Fixed<f> y, Fixed<f> x) {
+	return FixedMath::narrow<f>(FixedMath::angle(y.toRaw(), x.toRaw()));
+}
+
+template<int f> inline Fixed<f> atan(Fixed<f> x) {
+	return atan2(x, Fixed<f>(1));
+}
+
+template<int f> inline Fixed<f> asin(Fixed<f> x) {
+	if (x >=  1) return FixedMath::narrow<f>( FixedMath::half_pi);
+	if (x <= -1) return FixedMath::narrow<f>(-FixedMath::half_pi);
+	return atan2(x, sqrt(1 - x * x));
+}
+
+template<int f> inline Fixed<f> acos(Fixed<f> x) {
+	if (x >=  1) return 0;
+	if (x <= -1) return FixedMath::narrow<f>(FixedMath::pi);
+	return atan2(sqrt(1 - x * x), x);
+}
+
+template<int f> inline Fixed<f> exp(Fixed<f> x) {
+	int64_t a = FixedMath::widen(x);
+	int64_t k = a / FixedMath::ln2;
+	if (a < k * FixedMath::ln2) k--;
+	if (k >= 31 - f) return Fixed<f>::infinity();
+	if (k < -f - 1) return 0;
+	int64_t e = FixedMath::exponent(a - k * FixedMath::ln2);
+	return FixedMath::narrow<f>(k >= 0 ? e << k : e >> -k);
+}
+
+template<int f> inline Fixed<f> log(Fixed<f> x) {
+	if (x.toRaw() <= 0) return -Fixed<f>::infinity();
+	int bit = FixedMath::highestBit(x.toRaw());
+	int64_t m = int64_t(x.toRaw()) << (FixedMath::precision - bit);
+	return FixedMath::narrow<f>((bit - f) * FixedMath::ln2 + FixedMath::logarithm(m));
+}
+
+template<int f> inline Fixed<f> pow(Fixed<f> a, Fixed<f> b) {
+	if (floor(b) == b && fabs(b) < 32){
+		int32_t n = b.toInt();
+		Fixed<f> base = n < 0 ? 1 / a : a;
+		Fixed<f> result = 1;
+		for(n = n < 0 ? -n : n; n; n >>= 1){
+			if (n & 1) result *= base;
+			base *= base;
+		}
+		return result;
+	}
+	if (a.toRaw() <= 0) return 0;
+	return exp(b * log(a));
+}
+
+template<int f> inline Fixed<f> sinh(Fixed<f> x) {
+	return (exp(x) - exp(-x)) / 2;
+}
+
+template<int f> inline Fixed<f> cosh(Fixed<f> x) {
+	return (exp(x) + exp(-x)) / 2;
+}
+
+template<int f> inline Fixed<f> tanh(Fixed<f> x) {
+	if (x >  8) return  1;
+	if (x < -8) return -1;
+	Fixed<f> e = exp(2 * x);
+	return (e - 1) / (e + 1);
+}
+
+/// \}
+
+#endif
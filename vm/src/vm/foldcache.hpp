@@ -0,0 +1,48 @@
+/*   ____       _  __ _   ____            _
+ *  |  _ \  ___| |/ _| |_|  _ \ _ __ ___ | |_ ___
+ *  | | | |/ _ \ | |_| __| |_) | '__/ _ \| __/ _ \
+ *  | |_| |  __/ |  _| |_|  __/| | ( (_) | |( (_) )
+ *  |____/ \___|_|_|  \__|_|   |_|  \___/ \__\___/
+ *
+ * This file is part of DelftProto.
+ * See COPYING for license details.
+ */
+
+/// \file
+/// Provides the FoldCache class.
+
+#ifndef __FOLDCACHE_HPP
+#define __FOLDCACHE_HPP
+
+#include <types.hpp>
+#include <data.hpp>
+#include <address.hpp>
+
+/// The cached result of a FOLD_HOOD instruction.
+/**
+ * Used by FOLD_HOOD when \c INCREMENTAL_FOLD (the number of FOLD_HOOD instructions to cache) is defined.
+ * 
+ * Only results of fuse functions that are known to depend on nothing but their arguments are cached.
+ * When none of the imports changed since the result was computed (see NeighbourHood::version()), the cached result is used as it is.
+ * When the fuse function is also known to be associative and commutative,
+ * and the only changes gave values to imports that were not set (see NeighbourHood::additionsSince()),
+ * only those imports are folded into the cached result.
+ */
+class FoldCache {
+	
+	public:
+		Address site;        ///< The FOLD_HOOD instruction, or 0 when unused.
+		Address fuse;        ///< The fuse function.
+		Index   import;      ///< The (index of the) import.
+		Data    start;       ///< The value the folding started with.
+		Data    result;      ///< The result.
+		Counter version;     ///< The NeighbourHood::version() of the import that was used for the result.
+		bool    valid;       ///< Whether there is a result.
+		bool    pure;        ///< Whether the fuse function depends on nothing but its arguments.
+		bool    incremental; ///< Whether the fuse function is also associative and commutative.
+		
+		inline FoldCache() : site(0), fuse(0), import(0), version(0), valid(false), pure(false), incremental(false) {}
+	
+};
+
+#endif
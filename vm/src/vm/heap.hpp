@@ -0,0 +1,260 @@
+/*   ____       _  __ _   ____            _
+ *  |  _ \  ___| |/ _| |_|  _ \ _ __ ___ | |_ ___
+ *  | | | |/ _ \ | |_| __| |_) | '__/ _ \| __/ _ \
+ *  | |_| |  __/ |  _| |_|  __/| | ( (_) | |( (_) )
+ *  |____/ \___|_|_|  \__|_|   |_|  \___/ \__\___/
+ *
+ * This file is part of DelftProto.
+ * See COPYING for license details.
+ */
+
+/// \file
+/// Provides the Heap and HeapPointer classes.
+
+extern "C" {
+#	include <stdlib.h>
+#	include <string.h>
+}
+
+#ifndef __HEAP_HPP
+#define __HEAP_HPP
+
+#include <types.hpp>
+#include <memory.hpp>
+
+/** \cond */
+#ifndef HEAP_HANDLES
+#define HEAP_HANDLES (HEAP_SIZE / 16)
+#endif
+
+#ifndef HEAP_COMPACTION_STEP
+#define HEAP_COMPACTION_STEP 256
+#endif
+
+#ifndef HEAP_EXHAUSTED
+#define HEAP_EXHAUSTED() abort()
+#endif
+/** \endcond */
+
+/// A heap of \c HEAP_SIZE bytes with relocatable blocks, which can be compacted incrementally.
+/**
+ * Used for the contents of all SharedVectors (and therefore all Tuples) when \c HEAP_SIZE is defined.
+ *
+ * Blocks are not referred to by pointers, but by handles: indices in a table of (at most \c HEAP_HANDLES) pointers.
+ * The compactor slides the blocks in use together, and only has to update the table.
+ * A handle has to be resolved again after compacting, so pointers obtained from a handle
+ * must not be kept while compact() may run. The Machine runs it between runs (at the start of Machine::run()).
+ *
+ * Allocating is a pointer increment at the end of the used part, and deallocating only marks the block as free.
+ * When the heap is full, blocks are allocated with Memory instead (see overflowed()), until the compactor has made room again.
+ * When the handle table is full, \c HEAP_EXHAUSTED() is called, which must not return. It defaults to \c abort().
+ */
+class Heap {
+	
+	public:
+		/// A reference to a block. Zero refers to no block.
+		typedef Size Handle;
+	
+	protected:
+		
+		/// The allocation unit, which makes sure all allocations are suitably aligned.
+		union Unit {
+			void * pointer;
+			double number;
+			long integer;
+			Alignment alignment;
+		};
+		
+		/// The header in front of every block. The handle is zero for free blocks.
+		struct Header {
+			Size units;
+			Handle handle;
+		};
+		
+		static const Size header_units = (sizeof(Header) + sizeof(Unit) - 1) / sizeof(Unit);
+		static const Size capacity = (HEAP_SIZE + sizeof(Unit) - 1) / sizeof(Unit);
+		
+		struct State {
+			Unit block[capacity];
+			void * table[HEAP_HANDLES]; // The memory of every handle. Unused entries form a list through the table itself.
+			Handle unused;              // The first unused handle, or zero.
+			Handle fresh;               // The first handle that has never been used.
+			Size top;                   // The end of the used part of the block.
+			Size to;                    // The end of the compacted part.
+			Size from;                  // The start of the part that is not yet compacted.
+			bool overflow;
+			State() : unused(0), fresh(1), top(0), to(0), from(0), overflow(false) { table[0] = 0; }
+		};
+		
+		static inline State & state() {
+			static State s;
+			return s;
+		}
+		
+		static inline Size units(Size bytes) {
+			return (bytes + sizeof(Unit) - 1) / sizeof(Unit);
+		}
+		
+		static inline Header * header(Size position) {
+			return reinterpret_cast<Header *>(state().block + position);
+		}
+		
+		static inline Handle newHandle() {
+			State & s = state();
+			if (s.unused){
+				Handle handle = s.unused;
+				s.unused = s.table[handle] ? static_cast<void * *>(s.table[handle]) - s.table : 0;
+				return handle;
+			}
+			if (s.fresh < HEAP_HANDLES) return s.fresh++;
+			HEAP_EXHAUSTED();
+			return 0;
+		}
+		
+		static inline void deleteHandle(Handle handle) {
+			State & s = state();
+			s.table[handle] = s.unused ? &s.table[s.unused] : 0;
+			s.unused = handle;
+		}
+	
+	public:
+		
+		/// Allocate a block of a number of bytes.
+		static inline Handle allocate(Size bytes) {
+			State & s = state();
+			Handle handle = newHandle();
+			Size n = header_units + units(bytes);
+			if (n <= capacity - s.top){
+				Header * h = header(s.top);
+				h->units = n;
+				h->handle = handle;
+				s.table[handle] = s.block + s.top + header_units;
+				s.top += n;
+			} else {
+				s.overflow = true;
+				s.table[handle] = Memory<Unit>::allocate(units(bytes));
+			}
+			return handle;
+		}
+		
+		/// Deallocate a block allocated by allocate() with the same number of bytes.
+		static inline void deallocate(Handle handle, Size bytes) {
+			if (!handle) return;
+			State & s = state();
+			Unit * memory = static_cast<Unit *>(s.table[handle]);
+			if (contains(memory - header_units)) reinterpret_cast<Header *>(memory - header_units)->handle = 0;
+			else Memory<Unit>::deallocate(memory, units(bytes));
+			deleteHandle(handle);
+		}
+		
+		/// Get the memory of a block.
+		static inline void * resolve(Handle handle) {
+			return state().table[handle];
+		}
+		
+		/// Check whether the memory is part of the heap.
+		static inline bool contains(void const * memory) {
+			State & s = state();
+			return memory >= static_cast<void const *>(s.block) && memory < static_cast<void const *>(s.block + capacity);
+		}
+		
+		/// Slide the blocks in use together, moving at most about the given number of bytes.
+		/**
+		 * Compacting happens incrementally: every call continues where the previous one stopped.
+		 * When the end is reached, the free space of the heap is one piece again.
+		 *
+		 * \warning All pointers obtained through resolve() (and HeapPointer) are invalid afterwards.
+		 *
+		 * \return Whether a compaction was finished (true) or not (false).
+		 */
+		static inline bool compact(Size bytes = HEAP_COMPACTION_STEP) {
+			State & s = state();
+			Size budget = units(bytes);
+			while(s.from < s.top && budget){
+				Header * h = header(s.from);
+				Size n = h->units;
+				Size cost = 1;
+				if (h->handle){
+					if (s.to != s.from){
+						memmove(s.block + s.to, s.block + s.from, n * sizeof(Unit));
+						s.table[header(s.to)->handle] = s.block + s.to + header_units;
+						cost += n;
+					}
+					s.to += n;
+				}
+				s.from += n;
+				budget -= cost < budget ? cost : budget;
+			}
+			if (s.from < s.top) return false;
+			s.top = s.to;
+			s.to = s.from = 0;
+			s.overflow = false;
+			return true;
+		}
+		
+		/// The number of bytes of the heap in use, including free blocks that have not yet been compacted away.
+		static inline Size size() {
+			return state().top * sizeof(Unit);
+		}
+		
+		/// Check whether blocks had to be allocated with Memory since the last finished compaction.
+		static inline bool overflowed() {
+			return state().overflow;
+		}
+	
+};
+
+/// A pointer to a block in the Heap, which stays valid when the block is moved.
+/**
+ * \tparam Element The type of the element(s) in the block.
+ */
+template<typename Element>
+class HeapPointer {
+	
+	protected:
+		Heap::Handle handle;
+	
+	public:
+		/// A pointer to nothing.
+		inline HeapPointer() : handle(0) {}
+		
+		/// A pointer to the block with the given handle.
+		inline explicit HeapPointer(Heap::Handle handle) : handle(handle) {}
+		
+		/// Get the current address of the block.
+		inline operator Element * () const { return static_cast<Element *>(Heap::resolve(handle)); }
+		
+		/// Access the (first) element in the block.
+		inline Element * operator -> () const { return static_cast<Element *>(Heap::resolve(handle)); }
+		
+		/// The handle of the block.
+		inline Heap::Handle toHandle() const { return handle; }
+	
+};
+
+/// An interface to the memory (de)allocation functions, using the Heap.
+/**
+ * This has the same interface as Memory, except that it uses HeapPointers instead of pointers.
+ *
+ * \tparam Element The type of the element(s) to (de)allocate.
+ */
+template<typename Element>
+class HeapMemory {
+	public:
+		
+		/// The type of pointers to the allocated memory.
+		typedef HeapPointer<Element> Pointer;
+		
+		/// Allocate memory for a number of Elements (one when omitted).
+		static inline Pointer allocate(Size capacity = 1, void const * near = 0) {
+			return Pointer(Heap::allocate(capacity * sizeof(Element)));
+		}
+		
+		/// Deallocate memory, for the same number of Elements as given to allocate().
+		static inline void deallocate(Pointer memory, Size capacity = 1) {
+			Heap::deallocate(memory.toHandle(), capacity * sizeof(Element));
+		}
+	
+};
+
+#endif
@@ -23,6 +23,72 @@
  * This implementation assumes that on the used platform \c float is already an IEEE 754 binary32 floating point number.
  * Platforms can \ref fileoverloading "overload this file" if any conversion is needed.
  */
+#ifdef FIXED_POINT_NUMBER
+
+/**
+ * This implementation is used when Number is a Fixed point number.
+ * It converts using integer arithmetic only, so no (software) floating point support is needed.
+ * The bytes are expected in little endian order, like \c float on the supported platforms.
+ * 
+ * Values too large for the Fixed representation are saturated (to infinity), and values too small (including denormals) become zero.
+ */
+class IEEE754binary32 {
+		
+	private:
+		Int8 data[4];
+		
+	public:
+		
+		/// Convert from a Number.
+		IEEE754binary32(Number number) {
+			Number::Raw raw = number.toRaw();
+			uint32_t bits = 0;
+			if (raw == Number_infinity.toRaw() || raw == (-Number_infinity).toRaw()) {
+				bits = 0x7F800000;
+			} else if (raw) {
+				uint32_t magnitude = raw < 0 ? -uint32_t(raw) : uint32_t(raw);
+				int bit = 31;
+				while(!(magnitude >> bit)) bit--;
+				uint32_t mantissa = bit > 23 ? magnitude >> (bit - 23) : magnitude << (23 - bit);
+				bits = uint32_t(bit - Number::fraction + 127) << 23 | (mantissa & 0x7FFFFF);
+			}
+			if (raw < 0) bits |= 0x80000000;
+			for(Index i = 0; i < 4; i++) data[i] = bits >> (8 * i);
+		}
+		
+		/// Convert to a Number.
+		operator Number() {
+			uint32_t bits = 0;
+			for(Index i = 0; i < 4; i++) bits |= uint32_t(data[i]) << (8 * i);
+			int exponent = (bits >> 23) & 0xFF;
+			Number::Raw raw;
+			if (exponent == 0xFF) {
+				raw = Number_infinity.toRaw();
+			} else if (exponent == 0) {
+				raw = 0;
+			} else {
+				uint32_t mantissa = (bits & 0x7FFFFF) | 0x800000;
+				int shift = exponent - 150 + Number::fraction;
+				if      (shift >   7) raw = Number_infinity.toRaw();
+				else if (shift >=  0) raw = mantissa << shift;
+				else if (shift > -32) raw = (mantissa + (uint32_t(1) << (-shift - 1))) >> -shift;
+				else                  raw = 0;
+			}
+			return Number::fromRaw(bits & 0x80000000 ? -raw : raw);
+		}
+		
+		/// Convert from the IEEE 754 binary32 4 byte representation.
+		IEEE754binary32(Int8 data[4]) {
+			for(Index i = 0; i < 4; i++) this->data[i] = data[i];
+		}
+		
+		/// Convert to the IEEE 754 binary32 4 byte representation.
+		operator Int8 * () { return data; }
+		
+};
+
+#else
+
 class IEEE754binary32 {
 		
 	private:
@@ -46,3 +112,5 @@ class IEEE754binary32 {
 
 #endif
 
+#endif
+
@@ -0,0 +1,243 @@
+/*   ____       _  __ _   ____            _
+ *  |  _ \  ___| |/ _| |_|  _ \ _ __ ___ | |_ ___
+ *  | | | |/ _ \ | |_| __| |_) | '__/ _ \| __/ _ \
+ *  | |_| |  __/ |  _| |_|  __/| | ( (_) | |( (_) )
+ *  |____/ \___|_|_|  \__|_|   |_|  \___/ \__\___/
+ *
+ * This file is part of DelftProto.
+ * See COPYING for license details.
+ */
+
+/// \file
+/// Provides the ImportRow class.
+
+#ifndef __IMPORTROW_HPP
+#define __IMPORTROW_HPP
+
+#include <memory.hpp>
+#include <types.hpp>
+#include <data.hpp>
+
+/** \cond */
+#ifndef SPARSE_IMPORT_RATIO
+#define SPARSE_IMPORT_RATIO 4
+#endif
+/** \endcond */
+
+/// The imports of all Neighbours for the same export.
+/**
+ * The Neighbours are referred to by their position in the NeighbourHood.
+ * The imports are stored in one of two ways, depending on how many Neighbours have a value for the export:
+ *  - Sparse: the positions of the Neighbours that have a value, in ascending order, and an array of their values in the same order.
+ *    Looking up an import is a binary search, and a row without any values takes no memory at all.
+ *  - Dense: one Data object for every Neighbour the NeighbourHood has space for (its capacity), which is not set for Neighbours without a value.
+ * 
+ * A row starts sparse, and becomes dense when more than one in \c SPARSE_IMPORT_RATIO (4 by default) of the Neighbours the NeighbourHood has space for have a value.
+ * It becomes sparse again when that drops to half of it.
+ * 
+ * Storing a Data object that is not set removes the import.
+ */
+class ImportRow {
+	
+	protected:
+		
+		// The values: one per position when dense, or one per set import (and space - count unused ones) when sparse. All space of them are constructed.
+		Data * values;
+		
+		// The positions of the values when sparse.
+		Index * positions;
+		
+		// The number of imports that are set.
+		Size count;
+		
+		// The number of values (and positions) allocated.
+		Size space;
+		
+		bool dense;
+		
+		static inline Data const & unset() {
+			static Data const data;
+			return data;
+		}
+		
+		// The index of the first value with a position that is not smaller than the given one (only when sparse).
+		inline Index lower(Index position) const {
+			Index low = 0;
+			Index high = count;
+			while(low < high){
+				Index middle = (low + high) / 2;
+				if (positions[middle] < position) low = middle + 1;
+				else high = middle;
+			}
+			return low;
+		}
+		
+		// Replace the arrays by new ones of the given size, moving the set values to them.
+		inline void reallocate(Size new_space, bool new_dense) {
+			Data * new_values = new_space ? Memory<Data>::allocate(new_space) : 0;
+			Index * new_positions = new_space && !new_dense ? Memory<Index>::allocate(new_space) : 0;
+			for(Index i = 0; i < new_space; i++) new (&new_values[i]) Data();
+			Index n = 0;
+			for(Index i = 0; i < count; i++, n++){
+				while(dense && !values[n].isSet()) n++;
+				Index position = dense ? n : positions[n];
+				if (new_dense) new_values[position] = values[n];
+				else {
+					new_values[i] = values[n];
+					new_positions[i] = position;
+				}
+			}
+			release();
+			values = new_values;
+			positions = new_positions;
+			space = new_space;
+			dense = new_dense;
+		}
+		
+		inline void release() {
+			for(Index i = 0; i < space; i++) values[i].~Data();
+			if (values) Memory<Data>::deallocate(values, space);
+			if (positions) Memory<Index>::deallocate(positions, space);
+			values = 0;
+			positions = 0;
+			space = 0;
+		}
+		
+		// Insert a value when sparse, before the value at the given index.
+		inline void insert(Index index, Index position, Data const & value) {
+			if (count == space) reallocate(space ? space * 2 : 2, false);
+			for(Index i = count; i > index; i--){
+				values[i] = values[i - 1];
+				positions[i] = positions[i - 1];
+			}
+			values[index] = value;
+			positions[index] = position;
+			count++;
+		}
+		
+		// Remove the value at the given index when sparse.
+		inline void erase(Index index) {
+			for(Index i = index + 1; i < count; i++){
+				values[i - 1] = values[i];
+				positions[i - 1] = positions[i];
+			}
+			values[--count] = Data();
+		}
+		
+		// Change to sparse when few enough imports are set for a NeighbourHood with the given capacity.
+		inline void shrink(Size capacity) {
+			if (dense && count * 2 * SPARSE_IMPORT_RATIO <= capacity){
+				Size new_space = 2;
+				while(new_space < count) new_space *= 2;
+				reallocate(count ? new_space : 0, false);
+			}
+		}
+	
+	public:
+		
+		inline ImportRow() : values(0), positions(0), count(0), space(0), dense(false) {}
+		
+		inline ~ImportRow() {
+			release();
+		}
+		
+		/// The import of the Neighbour at the given position, which is not set when it has no value.
+		inline Data const & operator [] (Index position) const {
+			if (dense) return values[position];
+			Index i = lower(position);
+			return i < count && positions[i] == position ? values[i] : unset();
+		}
+		
+		/// The import of the Neighbour at the given position, or 0 when it has no value.
+		/**
+		 * \warning The import must stay set when it is changed through the pointer.
+		 */
+		inline Data * find(Index position) {
+			if (dense) return values[position].isSet() ? &values[position] : 0;
+			Index i = lower(position);
+			return i < count && positions[i] == position ? &values[i] : 0;
+		}
+		
+		/// The position of the first Neighbour, from the given position on, that has a value, or \a end if there is none before \a end.
+		inline Index next(Index position, Index end) const {
+			if (dense){
+				while(position < end && !values[position].isSet()) position++;
+				return position;
+			}
+			Index i = lower(position);
+			return i < count && positions[i] < end ? positions[i] : end;
+		}
+		
+		/// The number of Neighbours that have a value.
+		inline Size size() const {
+			return count;
+		}
+		
+		/// Check whether the imports are stored sparsely.
+		inline bool sparse() const {
+			return !dense;
+		}
+		
+		/// Set (or, when the value is not set, remove) the import of the Neighbour at the given position, in a NeighbourHood with the given capacity.
+		inline void set(Index position, Data const & value, Size capacity) {
+			if (!value.isSet()){
+				remove(position, capacity);
+				return;
+			}
+			if (!dense){
+				Index i = lower(position);
+				if (i < count && positions[i] == position){
+					values[i] = value;
+					return;
+				}
+				if (count + 1 <= capacity / SPARSE_IMPORT_RATIO){
+					insert(i, position, value);
+					return;
+				}
+				reallocate(capacity, true);
+			}
+			if (!values[position].isSet()) count++;
+			values[position] = value;
+		}
+		
+		/// Remove the import of the Neighbour at the given position, in a NeighbourHood with the given capacity.
+		inline void remove(Index position, Size capacity) {
+			if (dense){
+				if (!values[position].isSet()) return;
+				values[position] = Data();
+				count--;
+				shrink(capacity);
+				return;
+			}
+			Index i = lower(position);
+			if (i < count && positions[i] == position) erase(i);
+		}
+		
+		/// Move the import of the Neighbour at one position to another position, which must not have a value.
+		inline void move(Index from, Index to) {
+			if (dense){
+				values[to] = values[from];
+				values[from] = Data();
+				return;
+			}
+			Index i = lower(from);
+			if (i == count || positions[i] != from) return;
+			Data value = values[i];
+			erase(i);
+			insert(lower(to), to, value);
+		}
+		
+		/// Adapt to a new capacity of the NeighbourHood, which must be larger than the old one.
+		inline void resize(Size capacity) {
+			if (!dense) return;
+			if (count * 2 * SPARSE_IMPORT_RATIO <= capacity) shrink(capacity);
+			else reallocate(capacity, true);
+		}
+	
+	private:
+		ImportRow(ImportRow const &);
+		ImportRow & operator = (ImportRow const &);
+	
+};
+
+#endif
@@ -0,0 +1,163 @@
+/*   ____       _  __ _   ____            _
+ *  |  _ \  ___| |/ _| |_|  _ \ _ __ ___ | |_ ___
+ *  | | | |/ _ \ | |_| __| |_) | '__/ _ \| __/ _ \
+ *  | |_| |  __/ |  _| |_|  __/| | ( (_) | |( (_) )
+ *  |____/ \___|_|_|  \__|_|   |_|  \___/ \__\___/
+ *
+ * This file is part of DelftProto.
+ * See COPYING for license details.
+ */
+
+/// \file
+/// Provides the Inbox class.
+
+#ifndef __INBOX_HPP
+#define __INBOX_HPP
+
+extern "C" {
+#	include <stdint.h>
+}
+
+#include <types.hpp>
+#include <memory.hpp>
+#include <machineid.hpp>
+#include <message.hpp>
+
+/** \cond */
+#ifndef INBOX_MESSAGE_SIZE
+#define INBOX_MESSAGE_SIZE 256
+#endif
+/** \endcond */
+
+/// A queue of messages from neighbours, filled by any number of threads and emptied by the thread running the Machine.
+/**
+ * The Inbox holds \a capacity messages (a power of two) of at most \c INBOX_MESSAGE_SIZE (256 by default) bytes each,
+ * which are allocated once by the constructor, so push() does not allocate anything.
+ * 
+ * push() never blocks and never waits for other threads: a producer claims a slot with a single compare-and-swap,
+ * copies the message into it, and then publishes it. When the Inbox is full or the message is too large, the message is dropped.
+ * 
+ * The consumer collects the published messages in the order in which their slots were claimed,
+ * decodes them straight from their slots, and then gives the slots back with release().
+ * A producer that has claimed a slot but not published it yet holds back the messages after it until the next collect().
+ * 
+ * This is the bounded queue of Dmitry Vyukov, where every slot has a sequence number that tells whose turn it is:
+ * the producer of position p when it is p, the consumer when it is p + 1, and the producer of position p + capacity after that.
+ * 
+ * \see Machine::inbox
+ */
+class Inbox {
+	
+	protected:
+		
+		struct Slot {
+			Size sequence;
+			MachineId from;
+			Int8 signal;
+			Size size;
+			Int8 data[INBOX_MESSAGE_SIZE];
+		};
+		
+		Slot * slots;
+		Size capacity;
+		
+		// The next position to claim, shared by all producers, on a cache line of its own.
+		char padding_before[64];
+		Size enqueue_position;
+		char padding_after[64];
+		
+		// The next position to collect, and the messages that were collected but not released yet (consumer only).
+		Size dequeue_position;
+		NeighbourMessage * collected;
+		Size collected_size;
+	
+	private:
+		Inbox(Inbox const &);
+		Inbox & operator = (Inbox const &);
+	
+	public:
+		/// The constructor.
+		/**
+		 * \param capacity The maximum number of messages, which must be a power of two.
+		 */
+		explicit inline Inbox(Size capacity) : capacity(capacity), enqueue_position(0), dequeue_position(0), collected_size(0) {
+			slots = Memory<Slot>::allocate(capacity);
+			collected = Memory<NeighbourMessage>::allocate(capacity);
+			for(Index i = 0; i < capacity; i++) slots[i].sequence = i;
+		}
+		
+		/// The destructor.
+		inline ~Inbox() {
+			Memory<NeighbourMessage>::deallocate(collected, capacity);
+			Memory<Slot>::deallocate(slots, capacity);
+		}
+		
+		/// Add a message. This can be called by any thread, at any time.
+		/**
+		 * \param from The ID of the neighbour that sent the message.
+		 * \param data The message, as encoded by its ExportEncoder. It is copied.
+		 * \param size The length of the message in bytes.
+		 * \param signal The signal quality of the message (see NeighbourHood::heard()).
+		 * \return Whether the message was added. If not, the Inbox was full or the message larger than \c INBOX_MESSAGE_SIZE.
+		 */
+		inline bool push(MachineId const & from, Int8 const * data, Size size, Int8 signal = 0) {
+			if (size > INBOX_MESSAGE_SIZE) return false;
+			Size position = __atomic_load_n(&enqueue_position, __ATOMIC_RELAXED);
+			Slot * slot;
+			for(;;){
+				slot = &slots[position & (capacity - 1)];
+				Size sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+				if (sequence == position){
+					// Our turn: claim the position. On failure, position is updated to the current one.
+					if (__atomic_compare_exchange_n(&enqueue_position, &position, position + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+				} else if (intptr_t(sequence - position) < 0){
+					// The slot still holds the message from one lap ago: full.
+					// (Compared as a signed difference, so that this still holds when the counters wrap around.)
+					return false;
+				} else {
+					position = __atomic_load_n(&enqueue_position, __ATOMIC_RELAXED);
+				}
+			}
+			slot->from = from;
+			slot->signal = signal;
+			slot->size = size;
+			for(Index i = 0; i < size; i++) slot->data[i] = data[i];
+			__atomic_store_n(&slot->sequence, position + 1, __ATOMIC_RELEASE);
+			return true;
+		}
+		
+		/// Collect the messages that were published, in order, without copying them. Only for the consumer.
+		/**
+		 * The messages stay valid until release(), which must be called before the next collect().
+		 *
+		 * \param messages Set to the collected messages.
+		 * \return The number of collected messages.
+		 */
+		inline Size collect(NeighbourMessage const * & messages) {
+			Size count = 0;
+			for(;;){
+				Slot & slot = slots[(dequeue_position + count) & (capacity - 1)];
+				if (count == capacity || __atomic_load_n(&slot.sequence, __ATOMIC_ACQUIRE) != dequeue_position + count + 1) break;
+				collected[count].from = slot.from;
+				collected[count].data = slot.data;
+				collected[count].size = slot.size;
+				collected[count].signal = slot.signal;
+				count++;
+			}
+			collected_size = count;
+			messages = collected;
+			return count;
+		}
+		
+		/// Give the slots of the collected messages back to the producers. Only for the consumer.
+		inline void release() {
+			for(Index i = 0; i < collected_size; i++){
+				__atomic_store_n(&slots[(dequeue_position + i) & (capacity - 1)].sequence, dequeue_position + i + capacity, __ATOMIC_RELEASE);
+			}
+			dequeue_position += collected_size;
+			collected_size = 0;
+		}
+	
+};
+
+#endif
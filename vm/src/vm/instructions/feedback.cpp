@@ -22,7 +22,7 @@ namespace Instructions {
 	namespace {
 		void INIT_FEEDBACK_set_state(Machine & machine){
 			Data state = machine.stack.pop();
-			Index state_index = machine.stack.popNumber();
+			Index state_index = Index(toInteger(machine.stack.popNumber()));
 			machine.state[state_index].data = state;
 			machine.stack.push(state);
 		}
@@ -41,20 +41,16 @@ namespace Instructions {
 		Size       stack_size = machine.nextInt16();
 		Size environment_size = machine.nextInt8 ();
 		
-		machine.      stack.reset(   stack_size+20); // MIT Proto calculates the stack size slightly different than how DelftProto uses it. Add 20 to be safe.
-		machine.environment.reset(environment_size);
-		machine.    globals.reset(    globals_size);
-		machine.    threads.reset(               1);
-		machine.      state.reset(      state_size);
-		machine.       hood.reset(    exports_size);
+		Instruction callback = machine.callbacks.pop();
+		
+		// MIT Proto calculates the stack size slightly different than how DelftProto uses it. Add 20 to be safe.
+		if (!machine.reserve(stack_size+20, environment_size, globals_size, 1, state_size, exports_size, 3)) return; //TODO: callback depth ...
 		
 		machine.current_thread = 0;
 		machine.threads[0].activate();
 		
 		machine.hood.add(machine.id);
 		
-		Instruction callback = machine.callbacks.pop();
-		machine.callbacks.reset(3); //TODO: ...
 		machine.callbacks.push(callback);
 	}
 #endif
@@ -71,23 +67,43 @@ namespace Instructions {
 	 * \param Int The number of state variables.
 	 * \param Int The number of exports.
 	 * \param Int The maximum execution depth (for instructions that execute functions, such as MAP).
+	 * 
+	 * \note With \c STATIC_MEMORY, all of these are reserved in the StaticMemory at once.
+	 *       When they do not fit, StaticMemory::failed() is set and the installation ends here.
 	 */
 	void DEF_VM_EX(Machine & machine){
-		machine.      stack.reset(machine.nextInt());
-		machine.environment.reset(machine.nextInt());
-		machine.    globals.reset(machine.nextInt());
-		machine.    threads.reset(machine.nextInt());
-		machine.      state.reset(machine.nextInt());
-		machine.       hood.reset(machine.nextInt());
+		Size       stack_size = machine.nextInt();
+		Size environment_size = machine.nextInt();
+		Size     globals_size = machine.nextInt();
+		Size     threads_size = machine.nextInt();
+		Size       state_size = machine.nextInt();
+		Size     exports_size = machine.nextInt();
+		Size            depth = machine.nextInt();
+		
+		Instruction callback = machine.callbacks.pop();
+		
+		if (!machine.reserve(stack_size, environment_size, globals_size, threads_size, state_size, exports_size, depth)) return;
 		
 		machine.current_thread = 0;
 		
 		machine.hood.add(machine.id);
 		
-		Instruction callback = machine.callbacks.pop();
-		machine.callbacks.reset(machine.nextInt());
 		machine.callbacks.push(callback);
 	}
+	
+	/// Define the maximum size of the neighbourhood.
+	/**
+	 * This should be executed right after DEF_VM_EX.
+	 * When the neighbourhood is full, a new neighbour replaces one of the others (see NeighbourHood).
+	 * Without this, the maximum is \c HOOD_CAPACITY (no maximum when it is zero or not defined).
+	 * 
+	 * Its opcode comes after the ones of the original instruction set, so it does not change their opcodes.
+	 * 
+	 * \param Int The maximum number of neighbours (including this machine), or zero for no maximum.
+	 */
+	void DEF_HOOD(Machine & machine){
+		machine.hood.limit(machine.nextInt());
+	}
 #endif
 	
 	/// Exit the installation script.
@@ -141,7 +157,7 @@ namespace Instructions {
 		Data false_value = machine.stack.pop();
 		Data  true_value = machine.stack.pop();
 		Number condition = machine.stack.popNumber();
-		machine.stack.push(condition ? true_value : false_value);
+		machine.stack.push(condition != 0 ? true_value : false_value);
 	}
 	
 #if MIT_COMPATIBILITY != NO_MIT
@@ -151,7 +167,7 @@ namespace Instructions {
 		Data false_value = machine.stack.pop();
 		Data  true_value = machine.stack.pop();
 		Number condition = machine.stack.popNumber();
-		machine.stack.push(condition ? true_value : false_value);
+		machine.stack.push(condition != 0 ? true_value : false_value);
 	}
 #endif
 	
@@ -164,7 +180,7 @@ namespace Instructions {
 	 */
 	void IF(Machine & machine){
 		Size skip = machine.nextInt();
-		if (machine.stack.popNumber()) machine.skip(skip);
+		if (machine.stack.popNumber() != 0) machine.skip(skip);
 	}
 	
 #if MIT_COMPATIBILITY != NO_MIT
@@ -179,7 +195,7 @@ namespace Instructions {
 	 */
 	void IF16(Machine & machine){
 		Size skip = machine.nextInt16();
-		if (machine.stack.popNumber()) machine.skip(skip);
+		if (machine.stack.popNumber() != 0) machine.skip(skip);
 	}
 #endif
 	
@@ -211,7 +227,7 @@ namespace Instructions {
 		
 		void FUNCALL_end(Machine & machine){
 			Data result    = machine.stack.pop();
-			Size arguments = machine.stack.popNumber();
+			Size arguments = Size(toInteger(machine.stack.popNumber()));
 			machine.environment.pop(arguments);
 			machine.stack.push(result);
 		}
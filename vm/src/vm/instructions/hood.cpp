@@ -14,9 +14,132 @@
 #include <machine.hpp>
 #include <instructions.hpp>
 
+#ifdef HOOD_SIMD
+#include <reduce.hpp>
+#endif
+
+/** \cond */
+#ifndef PARALLEL_FOLD_CHUNK
+#define PARALLEL_FOLD_CHUNK 2048
+#endif
+/** \endcond */
+
 struct HoodInstructions {
 	
+#ifdef EXPORT_DIGEST
+	// The part of the export digest for an export, mixed with its index (with the finalizer of MurmurHash3), or zero when it is not set.
+	static uint32_t digest(Index index, Data const & value) {
+		if (!value.isSet()) return 0;
+		uint32_t h = value.hash() ^ uint32_t(index) * 0x9E3779B9u;
+		h ^= h >> 16; h *= 0x85EBCA6Bu;
+		h ^= h >> 13; h *= 0xC2B2AE35u;
+		h ^= h >> 16;
+		return h;
+	}
+#endif
+	
+	// Set an export of this machine, and update the export digest.
+	static void write_export(Machine & machine, Index index, Data const & value) {
+#ifdef EXPORT_DIGEST
+		machine.export_digest ^= digest(index, machine.thisMachine().imports[index]) ^ digest(index, value);
+#endif
+		machine.hood.update(machine.hood.begin(), index, value);
+	}
+	
+#if defined(INCREMENTAL_FOLD) || defined(HOOD_SIMD) || defined(PARALLEL_FOLD)
+	// The instruction of a fuse function that is nothing but a single ADD, MIN or MAX of both arguments, or zero for any other function.
+	static Int8 reduction(Address fuse) {
+		if (!((fuse[0] == Instructions::REF_0_OP && fuse[1] == Instructions::REF_1_OP) || (fuse[0] == Instructions::REF_1_OP && fuse[1] == Instructions::REF_0_OP))) return 0;
+		if (fuse[2] != Instructions::ADD_OP && fuse[2] != Instructions::MIN_OP && fuse[2] != Instructions::MAX_OP) return 0;
+		return fuse[3] == Instructions::RET_OP ? fuse[2] : 0;
+	}
+#endif
+	
+#ifdef INCREMENTAL_FOLD
+	// Find out whether a fuse function depends on nothing but its arguments, and whether it is also associative and commutative.
+	// Only the simplest functions are recognized: references to the arguments, literals and arithmetic, or a single ADD, MIN or MAX of both arguments.
+	static void analyse(FoldCache & cache) {
+		Address fuse = cache.fuse;
+		cache.pure = cache.incremental = false;
+		for(Index i = 0; i < 16; i++){
+			switch(fuse[i]){
+				case Instructions::REF_0_OP: case Instructions::REF_1_OP:
+				case Instructions::LIT_0_OP: case Instructions::LIT_1_OP:
+				case Instructions::ADD_OP: case Instructions::SUB_OP: case Instructions::MUL_OP:
+				case Instructions::MIN_OP: case Instructions::MAX_OP:
+					continue;
+				case Instructions::RET_OP:
+					cache.pure = true;
+					cache.incremental = i == 3 && reduction(fuse);
+					return;
+				default:
+					return;
+			}
+		}
+	}
+	
+	// Get the cache of a FOLD_HOOD instruction, or 0 when it can not be cached.
+	static FoldCache * cache(Machine & machine, Address site, Address fuse, Index import_index, Data const & start) {
+		FoldCache * cache = 0;
+		for(Index i = 0; i < machine.fold_caches.size() && !cache; i++) if (machine.fold_caches[i].site == site) cache = &machine.fold_caches[i];
+		for(Index i = 0; i < machine.fold_caches.size() && !cache; i++) if (!machine.fold_caches[i].site) cache = &machine.fold_caches[i];
+		if (!cache) return 0;
+		if (cache->site != site || cache->import != import_index || !cache->start.identical(start) || cache->fuse != fuse){
+			cache->site = site;
+			cache->import = import_index;
+			cache->start = start;
+			cache->valid = false;
+			if (cache->fuse != fuse){
+				cache->fuse = fuse;
+				analyse(*cache);
+			}
+		}
+		return cache->pure ? cache : 0;
+	}
+	
+	// Fold only the imports that changed (which are all new), into the cached result.
+	static void fold_hood_dirty_next(Machine & machine) {
+		ImportRow const & imports = machine.hood.row(machine.current_import);
+		machine.current_neighbour = machine.hood.next(machine.current_neighbour, machine.current_import);
+		while(machine.current_neighbour != machine.hood.end() && !machine.hood.dirty(machine.current_neighbour.index(), machine.current_import)){
+			machine.current_neighbour = machine.hood.next(++machine.current_neighbour, machine.current_import);
+		}
+		if (machine.current_neighbour != machine.hood.end()){
+			machine.environment.push(machine.stack.pop());
+			machine.environment.push(imports[machine.current_neighbour.index()]);
+			++machine.current_neighbour;
+			Address fuse = machine.stack.peek().asAddress();
+			machine.call(fuse,fold_hood_dirty_step);
+		} else {
+			fold_hood_finish(machine);
+		}
+	}
+	
+	static void fold_hood_dirty_step(Machine & machine) {
+		machine.environment.pop(2);
+		fold_hood_dirty_next(machine);
+	}
+#endif
+	
+	static void fold_hood_finish(Machine & machine) {
+		Data result = machine.stack.pop();
+		machine.stack.pop(1);
+		machine.stack.push(result);
+#ifdef INCREMENTAL_FOLD
+		if (machine.current_fold){
+			machine.current_fold->result = result;
+			machine.current_fold->version = machine.hood.version(machine.current_import);
+			machine.current_fold->valid = true;
+			machine.hood.clean(machine.current_import);
+			machine.current_fold = 0;
+		}
+#endif
+	}
+	
 	static void fold_hood(Machine & machine) {
+#ifdef INCREMENTAL_FOLD
+		Address site = machine.currentAddress();
+#endif
 		Index import_index = machine.nextInt();
 		Data export_value = machine.stack.pop();
 		Data result = machine.stack.pop();
@@ -24,7 +147,46 @@ struct HoodInstructions {
 		
 		machine.current_import = import_index;
 		
-		machine.thisMachine().imports[import_index] = export_value;
+		write_export(machine, import_index, export_value);
+		
+#ifdef INCREMENTAL_FOLD
+		machine.current_fold = cache(machine, site, fuse, import_index, result);
+		if (machine.current_fold && machine.current_fold->valid){
+			if (machine.current_fold->version == machine.hood.version(import_index)){
+				machine.stack.pop(1);
+				machine.stack.push(machine.current_fold->result);
+				machine.current_fold = 0;
+				return;
+			}
+			if (machine.current_fold->incremental && machine.hood.additionsSince(import_index, machine.current_fold->version)){
+				machine.current_neighbour = machine.hood.begin();
+				machine.stack.push(machine.current_fold->result);
+				fold_hood_dirty_next(machine);
+				return;
+			}
+		}
+#endif
+		
+#ifdef PARALLEL_FOLD
+		if (result.type() == Data::Type_number){
+			Int8 instruction = reduction(fuse);
+			if (instruction && fold_parallel(machine, instruction, import_index, result.asNumber())){
+				fold_hood_finish(machine);
+				return;
+			}
+		}
+#endif
+		
+#ifdef HOOD_SIMD
+		if (result.type() == Data::Type_number && machine.hood.onlyNumbers(import_index)){
+			Int8 instruction = reduction(fuse);
+			if (instruction){
+				machine.stack.push(reduce(machine, instruction, import_index, result.asNumber()));
+				fold_hood_finish(machine);
+				return;
+			}
+		}
+#endif
 		
 		machine.current_neighbour = machine.hood.begin();
 		
@@ -35,16 +197,15 @@ struct HoodInstructions {
 	
 	static void fold_hood_step(Machine & machine) {
 		machine.environment.pop(2);
-		while(++machine.current_neighbour != machine.hood.end() && !machine.current_neighbour->imports[machine.current_import].isSet());
+		ImportRow const & imports = machine.hood.row(machine.current_import);
+		machine.current_neighbour = machine.hood.next(++machine.current_neighbour, machine.current_import);
 		if (machine.current_neighbour != machine.hood.end()){
 			machine.environment.push(machine.stack.pop());
-			machine.environment.push(machine.current_neighbour->imports[machine.current_import]);
+			machine.environment.push(imports[machine.current_neighbour.index()]);
 			Address fuse = machine.stack.peek().asAddress();
 			machine.call(fuse,fold_hood_step);
 		} else {
-			Data result = machine.stack.pop();
-			machine.stack.pop(1);
-			machine.stack.push(result);
+			fold_hood_finish(machine);
 		}
 	}
 	
@@ -55,7 +216,7 @@ struct HoodInstructions {
 		
 		machine.current_import = import_index;
 		
-		machine.thisMachine().imports[import_index] = export_value;
+		write_export(machine, import_index, export_value);
 		
 		machine.current_neighbour = machine.hood.begin();
 		
@@ -64,9 +225,10 @@ struct HoodInstructions {
 	}
 	
 	static void fold_hood_filter_next(Machine & machine){
-		while(++machine.current_neighbour != machine.hood.end() && !machine.current_neighbour->imports[machine.current_import].isSet());
+		ImportRow const & imports = machine.hood.row(machine.current_import);
+		machine.current_neighbour = machine.hood.next(++machine.current_neighbour, machine.current_import);
 		if (machine.current_neighbour != machine.hood.end()){
-			machine.environment.push(machine.current_neighbour->imports[machine.current_import]);
+			machine.environment.push(imports[machine.current_neighbour.index()]);
 			Address filter = machine.stack.peek(1).asAddress();
 			machine.call(filter,fold_hood_plus_step_filter);
 		} else {
@@ -95,6 +257,192 @@ struct HoodInstructions {
 		fold_hood_filter_next(machine);
 	}
 	
+#if defined(HOOD_SIMD) || defined(PARALLEL_FOLD)
+	// Apply ADD, MIN or MAX to two Numbers.
+	static Number combine(Int8 instruction, Number a, Number b) {
+		if (instruction == Instructions::ADD_OP) return a + b;
+		if (instruction == Instructions::MIN_OP) return b < a ? b : a;
+		return b > a ? b : a;
+	}
+#endif
+	
+#ifdef HOOD_SIMD
+	// Reduce a number of imports (which must all be Numbers) with ADD, MIN or MAX.
+	static Number reduce(Int8 instruction, Number const * numbers, Size count) {
+		if (instruction == Instructions::ADD_OP) return Reduce::sum(numbers, count);
+		if (instruction == Instructions::MIN_OP) return Reduce::minimum(numbers, count);
+		return Reduce::maximum(numbers, count);
+	}
+	
+	// Reduce the imports (which must all be Numbers) with ADD, MIN or MAX, starting with the given value.
+	static Number reduce(Machine & machine, Int8 instruction, Index import_index, Number start) {
+		return combine(instruction, start, reduce(instruction, machine.hood.numbers(import_index), machine.hood.size()));
+	}
+#endif
+	
+#ifdef PARALLEL_FOLD
+	// A FOLD_HOOD with ADD, MIN or MAX as fuse function, split in chunks of PARALLEL_FOLD_CHUNK Neighbours.
+	struct ParallelFold {
+		NeighbourHood const * hood;
+		Index import;
+		Int8 instruction;
+		Number * results; // The result of every chunk.
+		bool * numbers;   // Whether all imports of a chunk were Numbers.
+	};
+	
+	// Fold the imports of a chunk, which only works when all of them are Numbers.
+	// This runs on any thread, so it does nothing but reading Numbers from the NeighbourHood.
+	static void fold_chunk(void * context, Index chunk) {
+		ParallelFold & fold = *static_cast<ParallelFold *>(context);
+		Index begin = chunk * PARALLEL_FOLD_CHUNK;
+		Index end = fold.hood->size() - begin > PARALLEL_FOLD_CHUNK ? begin + PARALLEL_FOLD_CHUNK : fold.hood->size();
+#ifdef HOOD_SIMD
+		if (fold.hood->onlyNumbers(fold.import)){
+			fold.results[chunk] = reduce(fold.instruction, fold.hood->numbers(fold.import) + begin, end - begin);
+			fold.numbers[chunk] = true;
+			return;
+		}
+#endif
+		ImportRow const & imports = fold.hood->row(fold.import);
+		Number result = fold.instruction == Instructions::ADD_OP ? Number(0) : fold.instruction == Instructions::MIN_OP ? Number_infinity : -Number_infinity;
+		for(Index i = imports.next(begin, end); i < end; i = imports.next(i + 1, end)){
+			Data const & import = imports[i];
+			if (import.type() != Data::Type_number){
+				fold.numbers[chunk] = false;
+				return;
+			}
+			result = combine(fold.instruction, result, import.asNumber());
+		}
+		fold.results[chunk] = result;
+		fold.numbers[chunk] = true;
+	}
+	
+	// Fold the imports in chunks on the worker threads, and push the result.
+	// Returns false (without pushing anything) when there is only one chunk, or when not all imports are Numbers.
+	static bool fold_parallel(Machine & machine, Int8 instruction, Index import_index, Number start) {
+		if (machine.hood.size() <= PARALLEL_FOLD_CHUNK) return false;
+		Size chunks = (machine.hood.size() + PARALLEL_FOLD_CHUNK - 1) / PARALLEL_FOLD_CHUNK;
+		if (machine.fold_results.size() < chunks){
+			machine.fold_results.reset(chunks);
+			machine.fold_numbers.reset(chunks);
+		}
+		ParallelFold fold = { &machine.hood, import_index, instruction, machine.fold_results, machine.fold_numbers };
+		machine.workers.run(fold_chunk, &fold, chunks);
+		bool numbers = true;
+		for(Index i = 0; i < chunks && numbers; i++){
+			numbers = fold.numbers[i];
+			start = combine(instruction, start, fold.results[i]);
+		}
+		if (numbers) machine.stack.push(start);
+		return numbers;
+	}
+#endif
+	
+	// Update the export of this machine (like FOLD_HOOD does) and get the index of the import.
+	static Index hood_import(Machine & machine) {
+		Index import_index = machine.nextInt();
+		Data export_value = machine.stack.pop();
+		write_export(machine, import_index, export_value);
+		return import_index;
+	}
+	
+	// Whether a value counts as true: a non-zero number, or a vector with a non-zero element.
+	static bool truth(Data const & value) {
+		if (value.type() == Data::Type_number) return value.asNumber() != 0;
+		if (value.type() != Data::Type_tuple) return false;
+		Tuple const & tuple = value.asTuple();
+		for(Index i = 0; i < tuple.size(); i++) if (truth(tuple[i])) return true;
+		return false;
+	}
+	
+	static void hood_sum(Machine & machine) {
+		Index import_index = hood_import(machine);
+#ifdef HOOD_SIMD
+		if (machine.hood.onlyNumbers(import_index)){
+			machine.stack.push(Reduce::sum(machine.hood.numbers(import_index), machine.hood.size()));
+			return;
+		}
+#endif
+		ImportRow const & imports = machine.hood.row(import_index);
+		Size size = machine.hood.size();
+		Number sum = 0;
+		Size length = 0;
+		for(Index i = imports.next(0, size); i < size; i = imports.next(i + 1, size)){
+			Data const & import = imports[i];
+			if (import.type() == Data::Type_number) sum += import.asNumber();
+			else if (import.type() == Data::Type_tuple && import.asTuple().size() > length) length = import.asTuple().size();
+		}
+		if (!length){
+			machine.stack.push(sum);
+			return;
+		}
+		// Numbers are added to the first element, like ADD does.
+		Tuple result(length);
+		for(Index e = 0; e < length; e++){
+			Number element = e ? 0 : sum;
+			for(Index i = imports.next(0, size); i < size; i = imports.next(i + 1, size)){
+				Data const & import = imports[i];
+				if (import.type() == Data::Type_tuple && e < import.asTuple().size()) element += import.asTuple()[e].asNumber();
+			}
+			result.push(element);
+		}
+		machine.stack.push(result);
+	}
+	
+	// Get the position of the (lexicographically) smallest (order = -1) or largest (order = 1) import, or the size of the hood when there are none.
+	// Of equal imports, the one of the neighbour with the lowest ID is taken.
+	static Index hood_extreme(Machine & machine, Index import_index, int order) {
+		Size size = machine.hood.size();
+		Index best = size;
+#ifdef HOOD_SIMD
+		if (machine.hood.onlyNumbers(import_index)){
+			Number const * numbers = machine.hood.numbers(import_index);
+			Number extreme = order < 0 ? Reduce::minimum(numbers, size) : Reduce::maximum(numbers, size);
+			for(Index i = 0; i < size; i++){
+				if (numbers[i] == extreme && (best == size || machine.hood.at(i).id < machine.hood.at(best).id)) best = i;
+			}
+			return best;
+		}
+#endif
+		ImportRow const & imports = machine.hood.row(import_index);
+		for(Index i = imports.next(0, size); i < size; i = imports.next(i + 1, size)){
+			if (imports[i].type() == Data::Type_address) continue;
+			if (best == size){
+				best = i;
+				continue;
+			}
+			int c = compare(imports[i], imports[best]);
+			if (c == order || (c == 0 && machine.hood.at(i).id < machine.hood.at(best).id)) best = i;
+		}
+		return best;
+	}
+	
+	static void hood_min_max(Machine & machine, int order) {
+		Index import_index = hood_import(machine);
+#ifdef HOOD_SIMD
+		if (machine.hood.onlyNumbers(import_index)){
+			Number const * numbers = machine.hood.numbers(import_index);
+			machine.stack.push(order < 0 ? Reduce::minimum(numbers, machine.hood.size()) : Reduce::maximum(numbers, machine.hood.size()));
+			return;
+		}
+#endif
+		Index best = hood_extreme(machine, import_index, order);
+		if (best == machine.hood.size()) machine.stack.push(order < 0 ? Number_infinity : -Number_infinity);
+		else machine.stack.push(machine.hood.row(import_index)[best]);
+	}
+	
+	static void hood_any_all(Machine & machine, bool all) {
+		ImportRow const & imports = machine.hood.row(hood_import(machine));
+		Size size = machine.hood.size();
+		for(Index i = imports.next(0, size); i < size; i = imports.next(i + 1, size)){
+			if (truth(imports[i]) != all){
+				machine.stack.push(all ? 0 : 1);
+				return;
+			}
+		}
+		machine.stack.push(all ? 1 : 0);
+	}
+	
 };
 
 namespace Instructions {
@@ -107,7 +455,7 @@ namespace Instructions {
 	 * \return Number The (unique) ID of this machine.
 	 */
 	void MID(Machine & machine){
-		machine.stack.push(machine.id);
+		machine.stack.push(Number(machine.id));
 	}
 	
 	/// Fold all imported values for a specific neighbourhood variable and update the corresponding export.
@@ -131,6 +479,16 @@ namespace Instructions {
 	 * }
 	 * \enddot
 	 * 
+	 * When \c INCREMENTAL_FOLD is defined, the result is cached and only recomputed when the imports changed (see FoldCache).
+	 * 
+	 * When \c HOOD_SIMD is defined, a fuse function that is nothing but ADD, MIN or MAX of its two arguments is not called at all
+	 * when the starting value and all imports are Numbers. The imports are reduced with vector instructions instead (see Reduce).
+	 * 
+	 * When \c PARALLEL_FOLD is defined, such a fold is split in chunks of \c PARALLEL_FOLD_CHUNK (2048 by default) Neighbours,
+	 * which are folded in parallel by the Machine's WorkerPool. The results of the chunks are combined in order,
+	 * so the result only depends on the chunk size, not on the number of threads.
+	 * A neighbourhood that fits in one chunk is folded as usual, without the WorkerPool.
+	 * 
 	 * \deprecated Implemented for MIT Proto compatibility.
 	 * \note There is currently no way of doing this without using deprecated instructions. (This will be fixed soon.)
 	 * 
@@ -192,6 +550,97 @@ namespace Instructions {
 		HoodInstructions::fold_hood_plus(machine);
 	}
 	
+#if MIT_COMPATIBILITY != MIT_ONLY
+	/// Sum the imported values for a specific neighbourhood variable and update the corresponding export.
+	/**
+	 * The export of this machine is set first, like FOLD_HOOD does, and the imports that are not set are skipped.
+	 * This gives the same result as FOLD_HOOD with ADD as fuse function and 0 as starting value, without calling a function for every neighbour.
+	 * 
+	 * \param Int The index of the neighbourhood (ie. import/export) variable.
+	 * \param Data The new export value for this Machine.
+	 * 
+	 * \return Data The sum of all imports.
+	 * 
+	 * \note If used on tuples, when one of the tuples is shorter, the remaining of the elements will be interpreted as 0.
+	 */
+	void HOOD_SUM(Machine & machine){
+		HoodInstructions::hood_sum(machine);
+	}
+	
+	/// Get the (lexicographical) minimum of the imported values for a specific neighbourhood variable and update the corresponding export.
+	/**
+	 * \param Int The index of the neighbourhood (ie. import/export) variable.
+	 * \param Data The new export value for this Machine.
+	 * 
+	 * \return Data The smallest import, or infinity when none is set.
+	 */
+	void HOOD_MIN(Machine & machine){
+		HoodInstructions::hood_min_max(machine, -1);
+	}
+	
+	/// Get the (lexicographical) maximum of the imported values for a specific neighbourhood variable and update the corresponding export.
+	/**
+	 * \param Int The index of the neighbourhood (ie. import/export) variable.
+	 * \param Data The new export value for this Machine.
+	 * 
+	 * \return Data The largest import, or minus infinity when none is set.
+	 */
+	void HOOD_MAX(Machine & machine){
+		HoodInstructions::hood_min_max(machine, 1);
+	}
+	
+	/// Check whether any of the imported values for a specific neighbourhood variable is true and update the corresponding export.
+	/**
+	 * A number is true when it is not zero, and a vector when any of its elements is.
+	 * 
+	 * \param Int The index of the neighbourhood (ie. import/export) variable.
+	 * \param Data The new export value for this Machine.
+	 * 
+	 * \return Number 1 when any import is true, 0 otherwise.
+	 */
+	void HOOD_ANY(Machine & machine){
+		HoodInstructions::hood_any_all(machine, false);
+	}
+	
+	/// Check whether all of the imported values for a specific neighbourhood variable are true and update the corresponding export.
+	/**
+	 * A number is true when it is not zero, and a vector when any of its elements is.
+	 * 
+	 * \param Int The index of the neighbourhood (ie. import/export) variable.
+	 * \param Data The new export value for this Machine.
+	 * 
+	 * \return Number 1 when all imports that are set are true, 0 otherwise.
+	 */
+	void HOOD_ALL(Machine & machine){
+		HoodInstructions::hood_any_all(machine, true);
+	}
+	
+	/// Count the neighbours that have a value for a specific neighbourhood variable and update the corresponding export.
+	/**
+	 * \param Int The index of the neighbourhood (ie. import/export) variable.
+	 * \param Data The new export value for this Machine.
+	 * 
+	 * \return Number The number of neighbours (including this machine) of which the import is set.
+	 */
+	void HOOD_COUNT(Machine & machine){
+		machine.stack.push(Number(machine.hood.row(HoodInstructions::hood_import(machine)).size()));
+	}
+	
+	/// Get the ID of the neighbour with the (lexicographically) smallest imported value for a specific neighbourhood variable and update the corresponding export.
+	/**
+	 * Of neighbours with equal values, the one with the lowest ID is taken.
+	 * 
+	 * \param Int The index of the neighbourhood (ie. import/export) variable.
+	 * \param Data The new export value for this Machine.
+	 * 
+	 * \return Number The ID of the neighbour, or the ID of this machine when no import is set.
+	 */
+	void HOOD_ARGMIN(Machine & machine){
+		Index best = HoodInstructions::hood_extreme(machine, HoodInstructions::hood_import(machine), -1);
+		machine.stack.push(Number(best == machine.hood.size() ? machine.id : machine.hood.at(best).id));
+	}
+#endif
+	
 	/// \}
 	
 }
@@ -140,7 +140,7 @@ namespace Instructions {
 	 */
 	void NOT(Machine & machine){
 		Number a = machine.stack.popNumber();
-		machine.stack.push(a ? 0 : 1);
+		machine.stack.push(a != 0 ? 0 : 1);
 	}
 	
 	/// \}
@@ -104,7 +104,7 @@ namespace Instructions {
 			Address & fold_fuse   = machine.stack.peek(2).asAddress();
 			if (++fold_index < fold_values.size()){
 				machine.environment.push(result);
-				machine.environment.push(fold_values[Index(fold_index)]);
+				machine.environment.push(fold_values[Index(toInteger(fold_index))]);
 				machine.call(fold_fuse, fold_step);
 			} else {
 				machine.stack.popNumber();
@@ -27,7 +27,7 @@ namespace Instructions {
 	 */
 	void DT(Machine & machine){
 		Number dt;
-		if (machine.currentThread().last_time) {
+		if (machine.currentThread().last_time != 0) {
 			dt = machine.startTime() - machine.currentThread().last_time;
 		} else {
 			dt = machine.currentThread().desired_period;
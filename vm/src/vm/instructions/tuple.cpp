@@ -26,7 +26,7 @@ namespace Instructions {
 	 * \return Data The element.
 	 */
 	void ELT(Machine & machine){
-		Index element = machine.stack.popNumber();
+		Index element = Index(toInteger(machine.stack.popNumber()));
 		Tuple  tuple  = machine.stack.popTuple ();
 		machine.stack.push(tuple[element]);
 	}
@@ -157,8 +157,8 @@ namespace Instructions {
 	void VSLICE(Machine & machine){
 		machine.nextInt8();
 		Tuple source = machine.stack.popTuple();
-		Index start = machine.stack.popNumber();
-		Index stop  = machine.stack.popNumber();
+		Index start = Index(toInteger(machine.stack.popNumber()));
+		Index stop  = Index(toInteger(machine.stack.popNumber()));
 		start = start >= 0 ? start : source.size() + start;
 		stop  = stop  >= 0 ? stop  : source.size() + stop ;
 		Tuple result(stop-start);
@@ -24,6 +24,23 @@
 #include <neighbourhood.hpp>
 #include <instructions.hpp>
 #include <machineid.hpp>
+#include <message.hpp>
+
+#ifdef INCREMENTAL_FOLD
+#include <foldcache.hpp>
+#endif
+
+#ifdef PARALLEL_FOLD
+#include <workerpool.hpp>
+#endif
+
+#ifdef INBOX_CAPACITY
+#include <inbox.hpp>
+#endif
+
+#ifdef MAILBOX_CAPACITY
+#include <mailbox.hpp>
+#endif
 
 class BasicMachine {
 	
@@ -60,6 +77,54 @@ class BasicMachine {
 		/** \memberof Machine */
 		NeighbourHood hood;
 		
+#ifdef NEIGHBOUR_TIMEOUT
+		/// The time after which a neighbour that has not been heard from is removed from the hood.
+		/**
+		 * The expired neighbours are removed at the start of every run (see NeighbourHood::expire()).
+		 * A timeout of zero disables this.
+		 * 
+		 * Only available when \c NEIGHBOUR_TIMEOUT (the initial timeout) is defined.
+		 * Without it, the host can still call NeighbourHood::expire() itself.
+		 */
+		/** \memberof Machine */
+		Time neighbour_timeout;
+#endif
+		
+#ifdef INBOX_CAPACITY
+		/// The messages from neighbours that other threads received, and that have not been applied to the hood yet.
+		/**
+		 * Any thread can add messages with Inbox::push() at any time, even while this Machine is running.
+		 * They are decoded into the hood at the start of the next run(), with the decoder,
+		 * so the hood never changes while a run is iterating through it.
+		 * 
+		 * Only available when \c INBOX_CAPACITY (the maximum number of messages waiting, a power of two) is defined.
+		 */
+		/** \memberof Machine */
+		Inbox inbox;
+#endif
+		
+#ifdef MAILBOX_CAPACITY
+		/// The newest message of every neighbour that other threads received, and that has not been applied to the hood yet.
+		/**
+		 * Any thread can replace the message of a neighbour with Mailbox::post() at any time, even while this Machine is running.
+		 * The messages are decoded into the hood at the start of the next run() (after the ones in the inbox, if any), with the decoder.
+		 * 
+		 * Only available when \c MAILBOX_CAPACITY (the maximum number of neighbours, a power of two) is defined.
+		 */
+		/** \memberof Machine */
+		Mailbox mailbox;
+#endif
+		
+#if defined(INBOX_CAPACITY) || defined(MAILBOX_CAPACITY)
+		/// The decoder for the messages in the inbox and the mailbox.
+		/**
+		 * It decodes Addresses into the script that was installed last.
+		 * When the neighbours send Numbers in other formats than float32, give them to its ExportDecoder::formats().
+		 */
+		/** \memberof Machine */
+		ExportDecoder decoder;
+#endif
+		
 	protected:
 		
 		/// The script that runs on this Machine.
@@ -103,10 +168,104 @@ class BasicMachine {
 		/** \memberof Machine */
 		Index current_import;
 		
+#ifdef INCREMENTAL_FOLD
+		/// The cached results of the FOLD_HOOD instructions.
+		/**
+		 * Only used when \c INCREMENTAL_FOLD (the number of FOLD_HOOD instructions to cache) is defined.
+		 */
+		/** \memberof Machine */
+		Array<FoldCache> fold_caches;
+		
+		/// The cache of the FOLD_HOOD instruction that is being executed, if any.
+		/** \memberof Machine */
+		FoldCache * current_fold;
+#endif
+		
+#ifdef EXPORT_DIGEST
+		/// The digest of the exports, kept up to date by the hood instructions that write them.
+		/**
+		 * Only used when \c EXPORT_DIGEST is defined.
+		 * \see exportDigest()
+		 */
+		/** \memberof Machine */
+		uint32_t export_digest;
+#endif
+		
+#ifdef PARALLEL_FOLD
+		/// The threads that help folding large neighbourhoods.
+		/**
+		 * Only used when \c PARALLEL_FOLD (the number of threads besides the one running the Machine) is defined.
+		 */
+		/** \memberof Machine */
+		WorkerPool workers;
+		
+		/// The result of every chunk of a parallel fold, kept to be reused by the next one.
+		/** \memberof Machine */
+		Array<Number> fold_results;
+		
+		/// Whether all imports of every chunk of a parallel fold were Numbers, kept to be reused by the next one.
+		/** \memberof Machine */
+		Array<bool> fold_numbers;
+#endif
+		
+#ifdef ROUND_REGION_SIZE
+		/// The Region in which the Tuples created during a run are allocated.
+		/**
+		 * It is reset at the start of every run.
+		 * Values that escape a run (the thread result, state, globals and exports) are moved out of it at the end of the run.
+		 * 
+		 * Only used when \c ROUND_REGION_SIZE (the size in bytes) is defined.
+		 */
+		/** \memberof Machine */
+		Region region;
+		
+		/// Whether a run is being executed (true) or not (false).
+		/** \memberof Machine */
+		bool running;
+#endif
+		
+#ifdef STATIC_MEMORY
+		/// The part of the StaticMemory reserved by the last DEF_VM or DEF_VM_EX.
+		/** \memberof Machine */
+		StaticMemory::Mark reservation;
+#endif
+		
+#ifdef MEMORY_STATISTICS
+		/// The memory usage of the current or last run.
+		/** \memberof Machine */
+		MemoryStatistics::Delta run_memory;
+#endif
+		
 	public:
 		
 		/// The constructor.
-		BasicMachine() : instruction_pointer(0), callbacks(1) {}
+		BasicMachine() :
+#ifdef NEIGHBOUR_TIMEOUT
+			neighbour_timeout(NEIGHBOUR_TIMEOUT),
+#endif
+#ifdef INBOX_CAPACITY
+			inbox(INBOX_CAPACITY),
+#endif
+#ifdef MAILBOX_CAPACITY
+			mailbox(MAILBOX_CAPACITY),
+#endif
+			instruction_pointer(0), callbacks(1)
+#ifdef INCREMENTAL_FOLD
+			, current_fold(0)
+#endif
+#ifdef EXPORT_DIGEST
+			, export_digest(0)
+#endif
+#ifdef PARALLEL_FOLD
+			, workers(PARALLEL_FOLD)
+#endif
+#ifdef ROUND_REGION_SIZE
+			, region(ROUND_REGION_SIZE), running(false)
+#endif
+#ifdef MEMORY_STATISTICS
+			, run_memory()
+#endif
+		{}
 		
 		/// \name Control flow
 		/// \{
@@ -176,6 +335,39 @@ class BasicMachine {
 				return current_thread;
 			}
 			
+#ifdef MEMORY_STATISTICS
+			/// Get the memory usage of all element types together.
+			/**
+			 * Only available when \c MEMORY_STATISTICS is defined.
+			 * 
+			 * \note The memory usage is counted for all Machines together.
+			 */
+			/** \memberof Machine */
+			static inline MemoryStatistics::Counters const & memoryUsage() {
+				return MemoryStatistics::total();
+			}
+			
+			/// Get the memory usage per element type, as a list linked by MemoryStatistics::Counters::next.
+			/**
+			 * Only available when \c MEMORY_STATISTICS is defined.
+			 */
+			/** \memberof Machine */
+			static inline MemoryStatistics::Counters const * memoryUsageByType() {
+				return MemoryStatistics::first();
+			}
+			
+			/// Get the memory usage of the last run (from run() until the thread returns).
+			/**
+			 * Only available when \c MEMORY_STATISTICS is defined.
+			 * 
+			 * \note While the run is not finished, only MemoryStatistics::Delta::start is valid.
+			 */
+			/** \memberof Machine */
+			inline MemoryStatistics::Delta const & lastRunMemoryUsage() const {
+				return run_memory;
+			}
+#endif
+			
 		/// \}
 		
 		/// \name Low level
@@ -250,6 +442,39 @@ class BasicMachine {
 				return *hood.begin();
 			}
 			
+#ifdef EXPORT_DIGEST
+			/// A digest of the values of all exports, which only changes when one of them does.
+			/**
+			 * The host can skip broadcasting the exports when the digest is the same as when it last did,
+			 * and send it along with the exports (see ExportEncoder::encode()) so that the neighbours can skip decoding them.
+			 * 
+			 * The digest is updated incrementally, for every export written by FOLD_HOOD, FOLD_HOOD_PLUS and the other hood instructions:
+			 * it is the exclusive or of a hash of every export that is set, mixed with its index, so that it is zero when no export is set.
+			 * Changes made to the exports in other ways (such as with NeighbourHood::update()) are not noticed.
+			 * 
+			 * Only available when \c EXPORT_DIGEST is defined.
+			 */
+			/** \memberof Machine */
+			inline uint32_t exportDigest() const {
+				return export_digest;
+			}
+#endif
+			
+			/// Receive a batch of messages from neighbours, such as all messages the network received since the last run.
+			/**
+			 * \see ExportDecoder::decode(NeighbourHood &, NeighbourMessage const *, Size, Time)
+			 * 
+			 * \param messages The messages, in the order they were received.
+			 * \param count The number of messages.
+			 * \param decoder The decoder for the messages, made for the currentScript().
+			 * \param now The time at which the messages were received.
+			 * \return The number of messages that were decoded and valid.
+			 */
+			/** \memberof Machine */
+			inline Size receive(NeighbourMessage const * messages, Size count, ExportDecoder const & decoder, Time now) {
+				return decoder.decode(hood, messages, count, now);
+			}
+			
 		/// \}
 		
 	protected:
@@ -281,6 +506,13 @@ typedef Machine ExtendedMachine;
 class Machine : public ExtendedMachine {
 	
 	public:
+#ifdef STATIC_MEMORY
+		/// Give back the reservation of the last DEF_VM or DEF_VM_EX to the StaticMemory.
+		inline ~Machine() {
+			unreserve();
+		}
+		
+#endif
 		/// \name Execution control
 		/// \{
 			
@@ -292,6 +524,9 @@ class Machine : public ExtendedMachine {
 			 */
 			inline void install(Script script) {
 				this->script = script;
+#if defined(INBOX_CAPACITY) || defined(MAILBOX_CAPACITY)
+				decoder.use(script);
+#endif
 				jump(Address(script));
 				callbacks.push(0);
 			}
@@ -300,13 +535,50 @@ class Machine : public ExtendedMachine {
 			/**
 			 * \note This does not execute Proto code, it only prepares the next run. Call step() while not finished() to execute it.
 			 * 
+			 * With \c HEAP_SIZE, this first continues compacting the Heap (see Heap::compact()).
+			 * With \c INBOX_CAPACITY, this first decodes the messages in the inbox into the hood (see receive()).
+			 * With \c MAILBOX_CAPACITY, this first decodes the messages in the mailbox into the hood (see Mailbox::deliver()).
+			 * With \c NEIGHBOUR_TIMEOUT, this first removes the expired neighbours (see neighbour_timeout).
+			 * With \c STATIC_MEMORY, when the StaticMemory runs out while doing so, no run is started and the stacks and arrays are left empty (see step()).
+			 *
 			 * \param start The time at the start of this run.
 			 */
 			inline void run(Time start) {
+#ifdef STATIC_MEMORY
+				Size exhaustions = StaticMemory::exhaustions();
+#endif
+#ifdef HEAP_SIZE
+				Heap::compact();
+#endif
+#ifdef INBOX_CAPACITY
+				NeighbourMessage const * messages;
+				Size count = inbox.collect(messages);
+				if (count) receive(messages, count, decoder, start);
+				inbox.release();
+#endif
+#ifdef MAILBOX_CAPACITY
+				mailbox.deliver(hood, decoder, start);
+#endif
+#ifdef NEIGHBOUR_TIMEOUT
+				if (neighbour_timeout > Time(0)) hood.expire(start, neighbour_timeout);
+#endif
+#ifdef STATIC_MEMORY
+				if (StaticMemory::exhaustions() != exhaustions){
+					abandon();
+					return;
+				}
+#endif
 				start_time = start;
 				for(Size i = 0; i < threads.size(); i++){
 					if (threads[current_thread].pending()){
 						threads[current_thread].untrigger();
+#ifdef ROUND_REGION_SIZE
+						region.reset();
+						running = true;
+#endif
+#ifdef MEMORY_STATISTICS
+						run_memory.begin();
+#endif
 						jump(globals.peek(current_thread).asAddress());
 						callbacks.push(run_callback);
 						return;
@@ -327,22 +599,120 @@ class Machine : public ExtendedMachine {
 						machine.state[i].is_executed = false;
 					}
 				}
+#ifdef ROUND_REGION_SIZE
+				machine.promote();
+#endif
+#ifdef MEMORY_STATISTICS
+				machine.run_memory.finish();
+#endif
 				machine.current_thread++;
 				if (machine.current_thread >= machine.threads.size()) machine.current_thread = 0;
 			}
 			
+#ifdef ROUND_REGION_SIZE
+			// Move all values that escape from the current run out of the region.
+			void promote(){
+				Region::active() = 0;
+				running = false;
+				bool all = region.overflowed();
+				threads[current_thread].result.promote(all);
+				for(Size i = 0; i < state.size(); i++) state[i].data.promote(all);
+				for(Size i = 0; i < globals.size(); i++) globals[i].promote(all);
+				if (!hood.empty()){
+					for(Size i = 0; i < thisMachine().imports.size(); i++){
+						Data * export_value = thisMachine().imports.find(i);
+						if (export_value) export_value->promote(all);
+					}
+				}
+#ifdef INCREMENTAL_FOLD
+				for(Size i = 0; i < fold_caches.size(); i++){
+					fold_caches[i].start.promote(all);
+					fold_caches[i].result.promote(all);
+				}
+#endif
+			}
+#endif
+			
+			// Reset the stacks and arrays to the sizes given by DEF_VM or DEF_VM_EX.
+			// With STATIC_MEMORY, they are reserved together, after giving back the previous reservation.
+			// When they do not fit, everything is left empty (which ends the installation) and false is returned.
+			bool reserve(Size stack_size, Size environment_size, Size globals_size, Size threads_size, Size state_size, Size exports_size, Size depth){
+#ifdef EXPORT_DIGEST
+				export_digest = 0;
+#endif
+#ifdef STATIC_MEMORY
+				unreserve();
+				Size bytes =
+					StaticMemory::bytes<Data>(stack_size) + StaticMemory::bytes<Data>(environment_size) + StaticMemory::bytes<Data>(globals_size) +
+					StaticMemory::bytes<Thread>(threads_size) + StaticMemory::bytes<State>(state_size) + StaticMemory::bytes<Instruction>(depth) +
+					NeighbourHood::bytes(exports_size);
+#ifdef INCREMENTAL_FOLD
+				bytes += StaticMemory::bytes<FoldCache>(INCREMENTAL_FOLD);
+#endif
+				if (bytes > StaticMemory::available()){
+					StaticMemory::fail();
+					return false;
+				}
+				StaticMemory::Reservation reserving(reservation);
+#endif
+				      stack.reset(      stack_size);
+				environment.reset(environment_size);
+				    globals.reset(    globals_size);
+				    threads.reset(    threads_size);
+				      state.reset(      state_size);
+				       hood.reset(    exports_size);
+				  callbacks.reset(           depth);
+#ifdef INCREMENTAL_FOLD
+				fold_caches.reset(INCREMENTAL_FOLD);
+#endif
+				return true;
+			}
+			
+#ifdef STATIC_MEMORY
+			// Empty the stacks and arrays, and give back their reservation.
+			void unreserve(){
+				stack.reset(); environment.reset(); globals.reset(); threads.reset(); state.reset(); hood.reset(0); callbacks.reset();
+#ifdef INCREMENTAL_FOLD
+				fold_caches.reset();
+#endif
+				StaticMemory::release(reservation);
+			}
+			
+			// End the installation or run in which the Pool ran out of memory, as if the installation did not fit,
+			// and keep the spare of the StaticMemory free again, now that the memory of the run was given back.
+			void abandon(){
+#ifdef ROUND_REGION_SIZE
+				running = false;
+#endif
+				unreserve();
+				StaticMemory::recovered();
+			}
+#endif
+			
 			/** \endcond */
 			
 		public:
 			/// Execute the next instruction.
 			/**
+			 * With \c STATIC_MEMORY, when the StaticMemory runs out during the instruction, the installation or run is ended
+			 * and the stacks and arrays are left empty, as when the installation did not fit (see StaticMemory::failed()).
+			 * 
 			 * \note Do not use this function when already finished().
 			 */
 			inline void step() {
+#ifdef STATIC_MEMORY
+				Size exhaustions = StaticMemory::exhaustions();
+#endif
+#ifdef ROUND_REGION_SIZE
+				Region::Scope scope(running ? &region : 0);
+#endif
 				Int8 opcode = nextInt8();
 				Instruction i = instructions[opcode];
 				if (i) execute(i);
 				else execute_unknown(opcode);
+#ifdef STATIC_MEMORY
+				if (StaticMemory::exhaustions() != exhaustions) abandon();
+#endif
 			}
 			
 			/// Check whether the running script (installation or a single run) has finished (true) or not (false).
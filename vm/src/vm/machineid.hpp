@@ -16,8 +16,29 @@
 
 #include <types.hpp>
 
+#ifdef INTEGER_MACHINE_ID
+
+#include <stdint.h>
+
+/// \class MachineId
+/// A Machine ID.
+/**
+ * An unsigned 32 bit integer, because \c INTEGER_MACHINE_ID is defined.
+ * Unlike a Number, this can represent every ID exactly.
+ * 
+ * \note Instructions::MID still pushes the ID as a Number.
+ */
+typedef uint32_t MachineId;
+
+#else
+
 /// \class MachineId
 /// A Machine ID.
+/**
+ * Define \c INTEGER_MACHINE_ID to use an unsigned 32 bit integer instead of a Number.
+ */
 typedef Number MachineId;
 
 #endif
+
+#endif
@@ -0,0 +1,183 @@
+/*   ____       _  __ _   ____            _
+ *  |  _ \  ___| |/ _| |_|  _ \ _ __ ___ | |_ ___
+ *  | | | |/ _ \ | |_| __| |_) | '__/ _ \| __/ _ \
+ *  | |_| |  __/ |  _| |_|  __/| | ( (_) | |( (_) )
+ *  |____/ \___|_|_|  \__|_|   |_|  \___/ \__\___/
+ *
+ * This file is part of DelftProto.
+ * See COPYING for license details.
+ */
+
+/// \file
+/// Provides the Mailbox class.
+
+#ifndef __MAILBOX_HPP
+#define __MAILBOX_HPP
+
+extern "C" {
+#	include <string.h>
+}
+
+#include <types.hpp>
+#include <memory.hpp>
+#include <machineid.hpp>
+#include <neighbourhood.hpp>
+#include <message.hpp>
+
+/** \cond */
+#ifndef MAILBOX_MESSAGE_SIZE
+#define MAILBOX_MESSAGE_SIZE 256
+#endif
+/** \endcond */
+
+/// One message slot per neighbour, that keeps only the newest message, filled by any number of threads and emptied by the thread running the Machine.
+/**
+ * When a neighbour sends several messages between two runs, only the last one is decoded (by deliver()),
+ * so the decoding work depends on the number of neighbours, not on the number of messages.
+ * This only works for full messages: a delta that overwrites an undecoded message loses the changes in that message
+ * until the next keyframe (see ExportEncoder), so neighbours that post to a Mailbox should send full messages only.
+ * 
+ * The Mailbox has room for \a capacity neighbours (a power of two) and messages of at most \c MAILBOX_MESSAGE_SIZE (256 by default) bytes,
+ * which are allocated once by the constructor, so post() does not allocate anything.
+ * A neighbour keeps its slot until clear().
+ * 
+ * Every slot has a sequence number, which is odd while a message is being written and increases by two for every message (a seqlock):
+ *  - post() claims the slot by making the sequence number odd with a compare-and-swap, copies the message, and makes it even again.
+ *    When another thread is writing a message for the same neighbour at the same moment, there is no newest one, and post() just drops its own.
+ *  - deliver() copies the message, and only uses it when the sequence number was the same (and even) before and after copying.
+ *    Otherwise the message is being overwritten, and the newer one is delivered next time.
+ * 
+ * Neither ever waits for the other, except for post() waiting for another thread that is claiming a slot for a new neighbour.
+ * 
+ * \see Machine::mailbox
+ */
+class Mailbox {
+	
+	protected:
+		
+		enum State {
+			State_empty,    // No neighbour.
+			State_claiming, // A thread is writing the ID of a new neighbour.
+			State_used      // The slot belongs to the neighbour with the ID.
+		};
+		
+		struct Slot {
+			Size state;
+			MachineId from;
+			Size sequence;
+			Int8 signal;
+			Size size;
+			Size words[(MAILBOX_MESSAGE_SIZE + sizeof(Size) - 1) / sizeof(Size)]; // The message, copied a word at a time.
+			Size delivered; // The sequence number of the last delivered message (consumer only).
+		};
+		
+		Slot * slots;
+		Size capacity;
+		
+		// Find the slot of a neighbour, or claim one when it has none. Returns 0 when the Mailbox is full.
+		inline Slot * find(MachineId const & from) {
+			Index home = NeighbourHood::hash(from) & (capacity - 1);
+			for(Index probe = 0; probe < capacity; probe++){
+				Slot & slot = slots[(home + probe) & (capacity - 1)];
+				Size state = __atomic_load_n(&slot.state, __ATOMIC_ACQUIRE);
+				if (state == State_empty){
+					if (__atomic_compare_exchange_n(&slot.state, &state, Size(State_claiming), false, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)){
+						slot.from = from;
+						__atomic_store_n(&slot.state, Size(State_used), __ATOMIC_RELEASE);
+						return &slot;
+					}
+				}
+				while(state == State_claiming) state = __atomic_load_n(&slot.state, __ATOMIC_ACQUIRE);
+				if (slot.from == from) return &slot;
+			}
+			return 0;
+		}
+	
+	private:
+		Mailbox(Mailbox const &);
+		Mailbox & operator = (Mailbox const &);
+	
+	public:
+		/// The constructor.
+		/**
+		 * \param capacity The maximum number of neighbours, which must be a power of two.
+		 */
+		explicit inline Mailbox(Size capacity) : capacity(capacity) {
+			slots = Memory<Slot>::allocate(capacity);
+			for(Index i = 0; i < capacity; i++){
+				slots[i].state = State_empty;
+				slots[i].sequence = 0;
+				slots[i].delivered = 0;
+			}
+		}
+		
+		/// The destructor.
+		inline ~Mailbox() {
+			Memory<Slot>::deallocate(slots, capacity);
+		}
+		
+		/// Replace the message of a neighbour. This can be called by any thread, at any time.
+		/**
+		 * \param from The ID of the neighbour that sent the message.
+		 * \param data The message, as encoded by its ExportEncoder. It is copied.
+		 * \param size The length of the message in bytes.
+		 * \param signal The signal quality of the message (see NeighbourHood::heard()).
+		 * \return Whether the message was stored. If not, the Mailbox was full, the message larger than \c MAILBOX_MESSAGE_SIZE,
+		 *         or another message from the same neighbour was being stored at the same time.
+		 */
+		inline bool post(MachineId const & from, Int8 const * data, Size size, Int8 signal = 0) {
+			if (size > MAILBOX_MESSAGE_SIZE) return false;
+			Slot * slot = find(from);
+			if (!slot) return false;
+			Size sequence = __atomic_load_n(&slot->sequence, __ATOMIC_RELAXED);
+			if (sequence & 1) return false;
+			if (!__atomic_compare_exchange_n(&slot->sequence, &sequence, sequence + 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) return false;
+			__atomic_thread_fence(__ATOMIC_RELEASE);
+			__atomic_store_n(&slot->signal, signal, __ATOMIC_RELAXED);
+			__atomic_store_n(&slot->size, size, __ATOMIC_RELAXED);
+			for(Index w = 0; w * sizeof(Size) < size; w++){
+				Size word = 0;
+				Size bytes = size - w * sizeof(Size) < sizeof(Size) ? size - w * sizeof(Size) : sizeof(Size);
+				memcpy(&word, data + w * sizeof(Size), bytes);
+				__atomic_store_n(&slot->words[w], word, __ATOMIC_RELAXED);
+			}
+			__atomic_store_n(&slot->sequence, sequence + 2, __ATOMIC_RELEASE);
+			return true;
+		}
+		
+		/// Decode the newest message of every neighbour that posted one since the last time into the hood. Only for the consumer.
+		/**
+		 * \param hood The hood to decode the messages into.
+		 * \param decoder The decoder for the messages.
+		 * \param now The time at which the messages were received, which becomes the Neighbour::last_heard of their senders.
+		 * \return The number of messages that were decoded and valid.
+		 */
+		inline Size deliver(NeighbourHood & hood, ExportDecoder const & decoder, Time now) {
+			Size decoded = 0;
+			Size words[(MAILBOX_MESSAGE_SIZE + sizeof(Size) - 1) / sizeof(Size)];
+			for(Index i = 0; i < capacity; i++){
+				Slot & slot = slots[i];
+				if (__atomic_load_n(&slot.state, __ATOMIC_ACQUIRE) != State_used) continue;
+				Size sequence = __atomic_load_n(&slot.sequence, __ATOMIC_ACQUIRE);
+				if (sequence == slot.delivered || (sequence & 1)) continue;
+				Int8 signal = __atomic_load_n(&slot.signal, __ATOMIC_RELAXED);
+				Size size = __atomic_load_n(&slot.size, __ATOMIC_RELAXED);
+				if (size > MAILBOX_MESSAGE_SIZE) continue;
+				for(Index w = 0; w * sizeof(Size) < size; w++) words[w] = __atomic_load_n(&slot.words[w], __ATOMIC_RELAXED);
+				__atomic_thread_fence(__ATOMIC_ACQUIRE);
+				if (__atomic_load_n(&slot.sequence, __ATOMIC_RELAXED) != sequence) continue;
+				slot.delivered = sequence;
+				NeighbourHood::iterator neighbour = hood.heard(slot.from, now, signal);
+				if (neighbour != hood.end() && decoder.decode(hood, neighbour, reinterpret_cast<Int8 const *>(words), size)) decoded++;
+			}
+			return decoded;
+		}
+		
+		/// Give all slots back, such as when the neighbours have changed. Only when no thread is posting.
+		inline void clear() {
+			for(Index i = 0; i < capacity; i++) slots[i].state = State_empty;
+		}
+	
+};
+
+#endif
@@ -18,8 +18,20 @@
 
 #include <types.hpp>
 
+#if defined(POOL_MEMORY) || defined(STATIC_MEMORY)
+#include <pool.hpp>
+#endif
+
+#ifdef MEMORY_STATISTICS
+#include <memorystatistics.hpp>
+#endif
+
 /// An interface to the memory (de)allocation functions.
 /**
+ * When \c POOL_MEMORY is defined, the memory is taken from the Pool instead of directly from \c new.
+ * When \c STATIC_MEMORY is defined, the Pool takes it from the StaticMemory instead of from the system.
+ * When \c MEMORY_STATISTICS is defined, all (de)allocations are counted by MemoryStatistics.
+ * 
  * \tparam Element The type of the element(s) to (de)allocate.
  */
 template<typename Element>
@@ -42,7 +54,14 @@ class Memory {
 		 * \endcode
 		 */
 		static inline Element * allocate(Size capacity = 1) {
+#ifdef MEMORY_STATISTICS
+			MemoryStatistics::allocated<Element>(capacity);
+#endif
+#if defined(POOL_MEMORY) || defined(STATIC_MEMORY)
+			return PoolMemory<Element>::allocate(capacity);
+#else
 			return static_cast<Element *>(operator new [] (capacity * sizeof(Element)));
+#endif
 		}
 		
 		/// Deallocate memory.
@@ -60,7 +79,14 @@ class Memory {
 		 * \endcode
 		 */
 		static inline void deallocate(Element * memory, Size capacity = 1) {
+#ifdef MEMORY_STATISTICS
+			if (memory) MemoryStatistics::deallocated<Element>(capacity);
+#endif
+#if defined(POOL_MEMORY) || defined(STATIC_MEMORY)
+			PoolMemory<Element>::deallocate(memory, capacity);
+#else
 			operator delete [] (memory);
+#endif
 		}
 		
 };
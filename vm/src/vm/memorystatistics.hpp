@@ -0,0 +1,157 @@
+/*   ____       _  __ _   ____            _
+ *  |  _ \  ___| |/ _| |_|  _ \ _ __ ___ | |_ ___
+ *  | | | |/ _ \ | |_| __| |_) | '__/ _ \| __/ _ \
+ *  | |_| |  __/ |  _| |_|  __/| | ( (_) | |( (_) )
+ *  |____/ \___|_|_|  \__|_|   |_|  \___/ \__\___/
+ *
+ * This file is part of DelftProto.
+ * See COPYING for license details.
+ */
+
+/// \file
+/// Provides the MemoryStatistics class.
+
+#ifndef __MEMORYSTATISTICS_HPP
+#define __MEMORYSTATISTICS_HPP
+
+#include <types.hpp>
+
+/// Counters for the memory allocated through Memory, per element type.
+/**
+ * This is only compiled in when \c MEMORY_STATISTICS is defined.
+ *
+ * The counters of an element type are added to the list (see first()) when that type is allocated for the first time.
+ * The counters are shared by all Machines.
+ *
+ * \see Machine::memoryUsage()
+ */
+class MemoryStatistics {
+	
+	public:
+		
+		/// The counters of one element type, or of all of them together.
+		struct Counters {
+			char const * name;     ///< The name of the element type (not zero terminated), or 0 for the total.
+			Size name_length;      ///< The length of the name.
+			Size live;             ///< The number of bytes currently allocated.
+			Size peak;             ///< The highest number of bytes allocated at once.
+			Counter allocations;   ///< The number of allocations.
+			Counter deallocations; ///< The number of deallocations.
+			Counters * next;       ///< The counters of the next element type, or 0.
+		};
+		
+		/// The memory usage during a period of time, such as a single Machine::run().
+		struct Delta {
+			Size start;            ///< The number of bytes allocated at the start.
+			Size end;              ///< The number of bytes allocated at the end.
+			Size peak;             ///< The highest number of bytes allocated at once in between.
+			Counter allocations;   ///< The number of allocations in between.
+			Counter deallocations; ///< The number of deallocations in between.
+			
+			/// Start the period.
+			inline void begin() {
+				start = end = peak = total().live;
+				// Remember the current counts, so that finish() can subtract them.
+				allocations   = total().allocations;
+				deallocations = total().deallocations;
+				state().period_peak = start;
+			}
+			
+			/// End the period.
+			inline void finish() {
+				end = total().live;
+				peak = state().period_peak;
+				allocations   = total().allocations   - allocations;
+				deallocations = total().deallocations - deallocations;
+			}
+		};
+	
+	protected:
+		
+		struct State {
+			Counters total;
+			Counters * first;
+			Size period_peak;
+		};
+		
+		static inline State & state() {
+			static State s = {{0, 0, 0, 0, 0, 0, 0}, 0, 0};
+			return s;
+		}
+		
+		static inline void add(Counters & counters, Size bytes) {
+			counters.live += bytes;
+			counters.allocations++;
+			if (counters.live > counters.peak) counters.peak = counters.live;
+		}
+		
+		static inline void remove(Counters & counters, Size bytes) {
+			counters.live -= bytes;
+			counters.deallocations++;
+		}
+		
+		// Get the element type out of a function name like "... [with Element = Data]".
+		static inline void setName(Counters & counters, char const * function) {
+			char const * name = function;
+			while(*name && !(name[0] == '=' && name[1] == ' ')) name++;
+			if (!*name){
+				counters.name = function;
+				counters.name_length = 0;
+				while(function[counters.name_length]) counters.name_length++;
+				return;
+			}
+			name += 2;
+			Size length = 0;
+			while(name[length] && name[length] != ']' && name[length] != ';') length++;
+			counters.name = name;
+			counters.name_length = length;
+		}
+	
+	public:
+		
+		/// The counters of all element types together.
+		static inline Counters const & total() {
+			return state().total;
+		}
+		
+		/// The counters of the first element type in the list.
+		static inline Counters const * first() {
+			return state().first;
+		}
+		
+		/// The counters of an element type.
+		template<typename Element>
+		static inline Counters & of() {
+			static Counters counters = {0, 0, 0, 0, 0, 0, 0};
+			if (!counters.name){
+#ifdef __GNUC__
+				setName(counters, __PRETTY_FUNCTION__);
+#else
+				setName(counters, "?");
+#endif
+				counters.next = state().first;
+				state().first = &counters;
+			}
+			return counters;
+		}
+		
+		/// Count an allocation of a number of Elements.
+		template<typename Element>
+		static inline void allocated(Size capacity) {
+			Size bytes = capacity * sizeof(Element);
+			add(of<Element>(), bytes);
+			add(state().total, bytes);
+			if (state().total.live > state().period_peak) state().period_peak = state().total.live;
+		}
+		
+		/// Count a deallocation of a number of Elements.
+		template<typename Element>
+		static inline void deallocated(Size capacity) {
+			Size bytes = capacity * sizeof(Element);
+			remove(of<Element>(), bytes);
+			remove(state().total, bytes);
+		}
+	
+};
+
+#endif
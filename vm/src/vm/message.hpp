@@ -0,0 +1,791 @@
+/*   ____       _  __ _   ____            _
+ *  |  _ \  ___| |/ _| |_|  _ \ _ __ ___ | |_ ___
+ *  | | | |/ _ \ | |_| __| |_) | '__/ _ \| __/ _ \
+ *  | |_| |  __/ |  _| |_|  __/| | ( (_) | |( (_) )
+ *  |____/ \___|_|_|  \__|_|   |_|  \___/ \__\___/
+ * 
+ * This file is part of DelftProto.
+ * See COPYING for license details.
+ */
+
+/// \file
+/// Provides the NumberFormat, MessageWriter, MessageReader, ExportEncoder and ExportDecoder classes.
+
+#ifndef __MESSAGE_HPP
+#define __MESSAGE_HPP
+
+extern "C" {
+#	include <stdint.h>
+}
+
+#include <memory.hpp>
+#include <types.hpp>
+#include <math.hpp>
+#include <array.hpp>
+#include <data.hpp>
+#include <tuple.hpp>
+#include <ieee754.hpp>
+#include <neighbour.hpp>
+#include <neighbourhood.hpp>
+#include <script.hpp>
+
+/** \cond */
+#ifndef MESSAGE_DEPTH
+#define MESSAGE_DEPTH 16
+#endif
+/** \endcond */
+
+/// How the Numbers of an export are sent.
+/**
+ * By default, Numbers are sent exactly, as IEEE754binary32.
+ * To save bandwidth, they can be sent with less precision instead: as a half precision float,
+ * or as one of 256 or 65536 evenly spaced values in a fixed range (Numbers outside the range are clamped to it).
+ * 
+ * The dead-band is used by an ExportEncoder that sends deltas: a Number that changed less than the dead-band
+ * since it was last sent counts as unchanged, and is not sent again (until the next keyframe).
+ * 
+ * The format applies to the Numbers in Tuples as well.
+ * 
+ * \see ExportEncoder::formats()
+ */
+class NumberFormat {
+	
+	public:
+		/// The encodings of a Number.
+		enum Encoding {
+			Encoding_float32, ///< Four bytes: IEEE 754 binary32.
+			Encoding_float16, ///< Two bytes: IEEE 754 binary16, which is exact for integers up to 2048 and has about three significant digits.
+			Encoding_fixed16, ///< Two bytes: a step of (maximum - minimum) / 65535.
+			Encoding_fixed8   ///< One byte: a step of (maximum - minimum) / 255.
+		};
+		
+		Encoding encoding; ///< The encoding.
+		Number minimum;    ///< The lowest value of a fixed range.
+		Number maximum;    ///< The highest value of a fixed range.
+		Number dead_band;  ///< The smallest change that is sent in a delta.
+	
+	protected:
+		static inline uint32_t toBits(Number value) {
+			IEEE754binary32 binary(value);
+			Int8 * bytes = binary;
+			return uint32_t(bytes[0]) | uint32_t(bytes[1]) << 8 | uint32_t(bytes[2]) << 16 | uint32_t(bytes[3]) << 24;
+		}
+		
+		static inline Number fromBits(uint32_t bits) {
+			Int8 bytes[4] = { Int8(bits), Int8(bits >> 8), Int8(bits >> 16), Int8(bits >> 24) };
+			return IEEE754binary32(bytes);
+		}
+		
+		// Round a binary32 to the nearest binary16 (ties to even).
+		static inline uint32_t toHalf(uint32_t bits) {
+			uint32_t sign = (bits >> 16) & 0x8000;
+			int exponent = int((bits >> 23) & 0xFF) - 127 + 15;
+			uint32_t mantissa = bits & 0x7FFFFF;
+			if (exponent == 0xFF - 127 + 15) return sign | 0x7C00 | (mantissa ? 0x200 : 0);
+			if (exponent >= 31) return sign | 0x7C00;
+			Size shift = 13;
+			if (exponent <= 0){
+				if (exponent < -10) return sign;
+				mantissa |= 0x800000;
+				shift = 14 - exponent;
+				exponent = 0;
+			}
+			uint32_t half = sign | uint32_t(exponent) << 10 | mantissa >> shift;
+			uint32_t rest = mantissa & ((uint32_t(1) << shift) - 1);
+			uint32_t middle = uint32_t(1) << (shift - 1);
+			if (rest > middle || (rest == middle && (half & 1))) half++; // A carry into the exponent is still correct.
+			return half;
+		}
+		
+		static inline uint32_t fromHalf(uint32_t half) {
+			uint32_t sign = (half & 0x8000) << 16;
+			int exponent = (half >> 10) & 0x1F;
+			uint32_t mantissa = half & 0x3FF;
+			if (exponent == 31) return sign | 0x7F800000 | (mantissa ? 0x400000 | mantissa << 13 : 0);
+			if (exponent == 0){
+				if (!mantissa) return sign;
+				exponent = 1;
+				while(!(mantissa & 0x400)){
+					mantissa <<= 1;
+					exponent--;
+				}
+				mantissa &= 0x3FF;
+			}
+			return sign | uint32_t(exponent + 127 - 15) << 23 | mantissa << 13;
+		}
+		
+		inline uint32_t steps() const {
+			return encoding == Encoding_fixed8 ? 0xFF : 0xFFFF;
+		}
+		
+		// The step (0 to steps()) nearest to the value.
+		inline uint32_t quantize(Number value) const {
+			Number t = (value - minimum) / (maximum - minimum);
+			if (!(t > Number(0))) return 0;
+			if (!(t < Number(1))) return steps();
+#ifdef FIXED_POINT_NUMBER
+			return uint32_t((int64_t(t.toRaw()) * steps() + (int64_t(1) << (Number::fraction - 1))) >> Number::fraction);
+#else
+			return uint32_t(t * Number(steps()) + Number(0.5));
+#endif
+		}
+		
+		inline Number dequantize(uint32_t step) const {
+#ifdef FIXED_POINT_NUMBER
+			Number t = Number::fromRaw(Number::Raw(((int64_t(step) << Number::fraction) + steps() / 2) / steps()));
+#else
+			Number t = Number(step) / Number(steps());
+#endif
+			return minimum + (maximum - minimum) * t;
+		}
+	
+	public:
+		/// The constructor.
+		/**
+		 * \param encoding The encoding.
+		 * \param minimum The lowest value of a fixed range (only used by \c Encoding_fixed8 and \c Encoding_fixed16).
+		 * \param maximum The highest value of a fixed range (only used by \c Encoding_fixed8 and \c Encoding_fixed16).
+		 * \param dead_band The smallest change that is sent in a delta.
+		 */
+		inline explicit NumberFormat(Encoding encoding = Encoding_float32, Number minimum = 0, Number maximum = 0, Number dead_band = 0)
+			: encoding(encoding), minimum(minimum), maximum(maximum), dead_band(dead_band) {}
+		
+		/// The number of bytes of an encoded Number.
+		inline Size bytes() const {
+			switch(encoding){
+				case Encoding_float16: return 2;
+				case Encoding_fixed16: return 2;
+				case Encoding_fixed8 : return 1;
+				default              : return 4;
+			}
+		}
+		
+		/// Encode a Number into bytes() bytes (in the lowest bits).
+		inline uint32_t encode(Number value) const {
+			switch(encoding){
+				case Encoding_float16: return toHalf(toBits(value));
+				case Encoding_fixed16:
+				case Encoding_fixed8 : return quantize(value);
+				default              : return toBits(value);
+			}
+		}
+		
+		/// Decode a Number encoded by encode().
+		inline Number decode(uint32_t bits) const {
+			switch(encoding){
+				case Encoding_float16: return fromBits(fromHalf(bits));
+				case Encoding_fixed16:
+				case Encoding_fixed8 : return dequantize(bits);
+				default              : return fromBits(bits);
+			}
+		}
+		
+		/// Check whether a value changed by at least the dead-band (true) or not (false) since it was sent.
+		/**
+		 * Numbers, and Tuples of the same size containing them, are compared with the dead-band.
+		 * Anything else has to be identical (see Data::identical()) to count as unchanged.
+		 */
+		inline bool changed(Data const & value, Data const & sent) const {
+			if (value.type() == Data::Type_number && sent.type() == Data::Type_number){
+				Number a = value.asNumber();
+				Number b = sent.asNumber();
+				return a != b && !(fabs(a - b) <= dead_band);
+			}
+			if (value.type() == Data::Type_tuple && sent.type() == Data::Type_tuple && value.asTuple().size() == sent.asTuple().size()){
+				Tuple const & a = value.asTuple();
+				Tuple const & b = sent.asTuple();
+				for(Index i = 0; i < a.size(); i++) if (changed(a[i], b[i])) return true;
+				return false;
+			}
+			return !value.identical(sent);
+		}
+	
+};
+
+/// Writes values in the wire format of messages into a buffer.
+/**
+ * The wire format consists of:
+ *  - Unsigned integers: a VLQ, seven bits per byte starting with the least significant ones,
+ *    with the high bit set on every byte except the last.
+ *  - Numbers: the four bytes of their IEEE754binary32 representation,
+ *    or the bytes of the NumberFormat given to format(), least significant first.
+ *  - Data: the Data::Type as an unsigned integer, followed by
+ *    nothing for undefined, a Number, the size of a Tuple followed by its elements,
+ *    or the offset of an Address from the start of the Script.
+ * 
+ * Nothing is allocated: the buffer is given by the caller.
+ * When it is full, the rest is not written and overflowed() becomes true.
+ */
+class MessageWriter {
+	
+	protected:
+		Int8 * buffer;
+		Size capacity;
+		Size used;
+		bool overflow;
+		Script script;
+		NumberFormat const * number_format;
+	
+	public:
+		/// Write into a buffer of \a capacity bytes.
+		/**
+		 * \param script The script that the Addresses in the Data point into. Without it, no Address can be written.
+		 */
+		inline MessageWriter(Int8 * buffer, Size capacity, Script script = Script()) : buffer(buffer), capacity(capacity), used(0), overflow(false), script(script), number_format(0) {}
+		
+		/// Write a single byte.
+		inline void byte(Int8 value) {
+			if (used < capacity) buffer[used++] = value; else overflow = true;
+		}
+		
+		/// Write an unsigned integer as a VLQ.
+		inline void vlq(Size value) {
+			while(value >= 0x80){
+				byte(Int8(value | 0x80));
+				value >>= 7;
+			}
+			byte(Int8(value));
+		}
+		
+		/// Write the Numbers that follow in the given format, or as IEEE754binary32 when it is 0.
+		inline void format(NumberFormat const * format) {
+			number_format = format;
+		}
+		
+		/// Write a Number as IEEE754binary32, or in the format given to format().
+		inline void number(Number value) {
+			if (number_format && number_format->encoding != NumberFormat::Encoding_float32){
+				uint32_t bits = number_format->encode(value);
+				for(Index i = 0; i < number_format->bytes(); i++) byte(Int8(bits >> (8 * i)));
+				return;
+			}
+			IEEE754binary32 binary(value);
+			Int8 * bytes = binary;
+			for(Index i = 0; i < 4; i++) byte(bytes[i]);
+		}
+		
+		/// Write a Data object, including the Tuples it contains.
+		/**
+		 * An Address outside the script can not be sent to another machine, which is treated like an overflow.
+		 */
+		inline void data(Data const & value) {
+			vlq(value.type());
+			switch(value.type()){
+				case Data::Type_undefined: break;
+				case Data::Type_number   : number(value.asNumber()); break;
+				case Data::Type_tuple    : {
+					Tuple const & tuple = value.asTuple();
+					vlq(tuple.size());
+					for(Index i = 0; i < tuple.size() && !overflow; i++) data(tuple[i]);
+					break;
+				}
+				case Data::Type_address  : {
+					Int8 const * address = value.asAddress();
+					Int8 const * start = script;
+					if (address < start || address >= start + script.size()) overflow = true;
+					else vlq(address - start);
+					break;
+				}
+			}
+		}
+		
+		/// The number of bytes written.
+		inline Size size() const { return used; }
+		
+		/// Check whether something did not fit in the buffer (true) or not (false).
+		inline bool overflowed() const { return overflow; }
+	
+};
+
+/// Reads values in the wire format of messages (see MessageWriter) from a buffer.
+/**
+ * Everything that is read is validated: a value that does not fit in the rest of the buffer, an unknown Data::Type,
+ * an Address outside the Script, or Tuples nested deeper than \c MESSAGE_DEPTH (16 by default) make failed() true.
+ * After that, nothing more is read.
+ */
+class MessageReader {
+	
+	protected:
+		Int8 const * buffer;
+		Size length;
+		Index position;
+		bool error;
+		Script script;
+		NumberFormat const * number_format;
+		
+		inline void data(Data & value, Size depth) {
+			Size type = vlq();
+			if (error) return;
+			switch(type){
+				case Data::Type_undefined: value.reset(); break;
+				case Data::Type_number   : {
+					Number n = number();
+					if (!error) value.reset(n);
+					break;
+				}
+				case Data::Type_tuple    : {
+					Size size = vlq();
+					// Every element takes at least one byte, so a larger Tuple can only be garbage.
+					if (size > remaining() || depth == MESSAGE_DEPTH){ fail(); break; }
+					if (value.type() == Data::Type_tuple && value.asTuple().size() == size && value.asTuple().instances() == 1){
+						Data * elements = value.asTuple();
+						for(Index i = 0; i < size && !error; i++) data(elements[i], depth + 1);
+					} else {
+						Tuple tuple(size);
+						for(Index i = 0; i < size && !error; i++){
+							Data element;
+							data(element, depth + 1);
+							tuple.push(element);
+						}
+						value.reset(tuple);
+					}
+					break;
+				}
+				case Data::Type_address  : {
+					Size offset = vlq();
+					if (offset >= script.size()) fail();
+					if (!error) value.reset(Address(static_cast<Int8 const *>(script) + offset));
+					break;
+				}
+				default: fail();
+			}
+		}
+	
+	public:
+		/// Read from a buffer of \a length bytes.
+		/**
+		 * \param script The script that received Addresses point into. Without it, no Address can be read.
+		 */
+		inline MessageReader(Int8 const * buffer, Size length, Script script = Script()) : buffer(buffer), length(length), position(0), error(false), script(script), number_format(0) {}
+		
+		/// Read a single byte.
+		inline Int8 byte() {
+			if (position < length) return buffer[position++];
+			fail();
+			return 0;
+		}
+		
+		/// Read an unsigned integer written as a VLQ.
+		inline Size vlq() {
+			Size value = 0;
+			for(Size shift = 0; shift < 8 * sizeof(Size); shift += 7){
+				Int8 b = byte();
+				value |= Size(b & 0x7F) << shift;
+				if (!(b & 0x80)) return value;
+			}
+			fail();
+			return 0;
+		}
+		
+		/// Read the Numbers that follow in the given format, or as IEEE754binary32 when it is 0.
+		inline void format(NumberFormat const * format) {
+			number_format = format;
+		}
+		
+		/// Read a Number written as IEEE754binary32, or in the format given to format().
+		inline Number number() {
+			if (number_format && number_format->encoding != NumberFormat::Encoding_float32){
+				uint32_t bits = 0;
+				for(Index i = 0; i < number_format->bytes(); i++) bits |= uint32_t(byte()) << (8 * i);
+				return number_format->decode(bits);
+			}
+			Int8 bytes[4];
+			for(Index i = 0; i < 4; i++) bytes[i] = byte();
+			return IEEE754binary32(bytes);
+		}
+		
+		/// Read a Data object into \a value.
+		/**
+		 * When \a value already holds a Tuple of the same size that is not shared with anything else,
+		 * its elements are overwritten instead of allocating a new Tuple. This is done for the Tuples it contains as well.
+		 */
+		inline void data(Data & value) {
+			data(value, 0);
+		}
+		
+		/// The Data::Type of the next value, without reading it.
+		/**
+		 * \return The type, or Data::Type_undefined when there is nothing left.
+		 */
+		inline Data::Type peekType() const {
+			return position < length && buffer[position] <= Data::Type_address ? Data::Type(buffer[position]) : Data::Type_undefined;
+		}
+		
+		/// Mark the message as invalid.
+		inline void fail() { error = true; }
+		
+		/// Check whether the message is invalid (true) or not (false).
+		inline bool failed() const { return error; }
+		
+		/// The number of bytes that are not read yet.
+		inline Size remaining() const { return length - position; }
+	
+};
+
+/// Encodes the exports of a machine into a message for its neighbours.
+/**
+ * The exports of a machine are the imports of Machine::thisMachine(), as filled by the FOLD_HOOD instructions.
+ * A message is:
+ *  - The kind of message: ExportEncoder::Kind_full or ExportEncoder::Kind_delta, plus ExportEncoder::Kind_digest when a digest follows.
+ *  - Optionally, the digest of all exports (see Machine::exportDigest()), as four bytes, least significant first.
+ *  - The number of exports in the message.
+ *  - For each of those: the index of the export, followed by its value.
+ * 
+ * All of these are written with a MessageWriter.
+ * The exports are listed in ascending order.
+ * 
+ * A full message has all exports that are set. When a keyframe interval is given, most messages are deltas instead:
+ * they only have the exports that changed since the previous message, with an undefined value for the ones that are no longer set.
+ * Every keyframe interval messages, a full message (a keyframe) is sent, so that new neighbours,
+ * and neighbours that missed a message, get all exports again.
+ * Call keyframe() to send one earlier, such as when a new neighbour is heard from.
+ * For this, the encoder keeps a copy of all exports it sent.
+ * 
+ * The Numbers in the exports can be sent with less precision, and changes smaller than a dead-band can be left out of deltas,
+ * with a NumberFormat per export (see formats()). The ExportDecoder must be given the same formats.
+ * 
+ * \code
+ * ExportEncoder encoder(machine.currentScript());
+ * Int8 message[64];
+ * Size size = encoder.encode(machine.thisMachine().imports, message, sizeof(message));
+ * if (size) radio.send(message, size);
+ * \endcode
+ * 
+ * With \c EXPORT_DIGEST, the host can skip a broadcast when the exports have not changed since the last one,
+ * and send the digest along, so that neighbours that already have these exports skip decoding the message:
+ * \code
+ * if (machine.exportDigest() != last_digest || heartbeat){
+ * 	Size size = encoder.encode(machine.thisMachine().imports, machine.exportDigest(), message, sizeof(message));
+ * 	if (size) radio.send(message, size);
+ * 	last_digest = machine.exportDigest();
+ * }
+ * \endcode
+ * 
+ * \see ExportDecoder
+ */
+class ExportEncoder {
+	
+	public:
+		/// The kinds of messages.
+		enum Kind {
+			Kind_full,      ///< All exports that are set.
+			Kind_delta,     ///< The exports that changed since the previous message.
+			Kind_digest = 2 ///< Added to the kind when the message has the digest of the exports.
+		};
+	
+	protected:
+		Script script;
+		Size keyframe_interval;
+		Size until_keyframe; // The number of deltas to send before the next keyframe.
+		Array<Data> sent;    // Copies of the exports in the previous message.
+		Array<bool> changed; // The exports to put in the message that is being encoded.
+		NumberFormat const * number_formats;
+		Size format_count;
+		
+		inline NumberFormat const * format(Index i) const {
+			return i < format_count ? &number_formats[i] : 0;
+		}
+		
+		inline bool differs(Data const & value, Data const & sent, NumberFormat const * format) const {
+			return format ? format->changed(value, sent) : !value.identical(sent);
+		}
+		
+		// Encode the exports, with the digest when it is given.
+		inline Size write(Imports const & exports, uint32_t const * digest, Int8 * buffer, Size capacity) {
+			if (keyframe_interval && sent.size() != exports.size()){
+				sent.reset(exports.size());
+				changed.reset(exports.size());
+				until_keyframe = 0;
+			}
+			bool full = !keyframe_interval || !until_keyframe;
+			Size count = 0;
+			for(Index i = 0; i < exports.size(); i++){
+				bool include = full ? exports[i].isSet() : differs(exports[i], sent[i], format(i));
+				if (keyframe_interval) changed[i] = include;
+				if (include) count++;
+			}
+			MessageWriter writer(buffer, capacity, script);
+			writer.vlq((full ? Kind_full : Kind_delta) | (digest ? Kind_digest : 0));
+			if (digest) for(Index b = 0; b < 4; b++) writer.byte(Int8(*digest >> (8 * b)));
+			writer.vlq(count);
+			for(Index i = 0; i < exports.size() && !writer.overflowed(); i++){
+				if (keyframe_interval ? !changed[i] : !exports[i].isSet()) continue;
+				writer.vlq(i);
+				writer.format(format(i));
+				writer.data(exports[i]);
+			}
+			if (writer.overflowed()) return 0;
+			if (keyframe_interval){
+				if (full) for(Index i = 0; i < exports.size(); i++) sent[i] = exports[i].copy();
+				else for(Index i = 0; i < exports.size(); i++) if (changed[i]) sent[i] = exports[i].copy();
+				until_keyframe = full ? keyframe_interval - 1 : until_keyframe - 1;
+			}
+			return writer.size();
+		}
+	
+	public:
+		/// The constructor.
+		/**
+		 * \param script The script running on the machine, which the exported Addresses point into.
+		 * \param keyframe_interval Send a full message once every this many messages, and deltas in between. Zero sends only full messages.
+		 */
+		inline explicit ExportEncoder(Script script = Script(), Size keyframe_interval = 0) : script(script), keyframe_interval(keyframe_interval), until_keyframe(0), number_formats(0), format_count(0) {}
+		
+		/// Send the Numbers of the first \a count exports in the given formats, one per export.
+		/**
+		 * The other exports are sent exactly. The formats are not copied, so they must stay valid.
+		 */
+		inline void formats(NumberFormat const * formats, Size count) {
+			number_formats = formats;
+			format_count = count;
+		}
+		
+		/// Make the next message a full message.
+		inline void keyframe() {
+			until_keyframe = 0;
+		}
+		
+		/// Encode the exports into a buffer.
+		/**
+		 * A delta only counts as sent when it fits, so the next message still has the changes of a message that did not fit.
+		 * 
+		 * \return The size of the message, or 0 when it did not fit in \a capacity bytes.
+		 */
+		inline Size encode(Imports const & exports, Int8 * buffer, Size capacity) {
+			return write(exports, 0, buffer, capacity);
+		}
+		
+		/// Encode the exports into a buffer, with their digest (see Machine::exportDigest()).
+		/**
+		 * A neighbour that already has the exports with this digest (from a full message) does not decode the rest of the message.
+		 * 
+		 * \return The size of the message, or 0 when it did not fit in \a capacity bytes.
+		 */
+		inline Size encode(Imports const & exports, uint32_t digest, Int8 * buffer, Size capacity) {
+			return write(exports, &digest, buffer, capacity);
+		}
+	
+};
+
+/// A message received from a neighbour, for decoding in a batch (see ExportDecoder::decode(NeighbourHood &, NeighbourMessage const *, Size, Time)).
+struct NeighbourMessage {
+	MachineId from; ///< The ID of the neighbour that sent the message.
+	Int8 const * data; ///< The message, as encoded by its ExportEncoder.
+	Size size; ///< The length of the message in bytes.
+	Int8 signal; ///< The signal quality of the message (see NeighbourHood::heard()).
+};
+
+/// Decodes a message from a neighbour (see ExportEncoder) into its imports.
+/**
+ * The message is validated while it is decoded, in a single pass, and every value is written directly into the import it is for.
+ * Numbers are written with NeighbourHood::update(), which does not allocate anything for them.
+ * A Tuple is written into the Tuple the import already has, when that has the same size and is not shared with anything else
+ * (see MessageReader::data()), so a neighbour that keeps sending vectors of the same size causes no allocations.
+ * 
+ * A full message resets the imports that are not in it. A delta only patches the imports that are in it,
+ * so the imports of a neighbour are only complete after its first full message.
+ * 
+ * With \c EXPORT_DIGEST, the digest of a full message is kept in the Neighbour (see Neighbour::digest),
+ * and a message with the same digest is not decoded at all: the imports already are those exports.
+ * A delta does not make the digest known, because the imports can miss the changes of an earlier delta that was lost.
+ * Without \c EXPORT_DIGEST, the digest in a message is ignored.
+ * 
+ * \code
+ * ExportDecoder decoder(machine.currentScript());
+ * NeighbourHood::iterator neighbour = machine.hood.heard(id, now);
+ * if (neighbour != machine.hood.end()) decoder.decode(machine.hood, neighbour, message, size);
+ * \endcode
+ * 
+ * A network that receives many messages at once can pass them all to Machine::receive() (or decode() with an array of NeighbourMessage) instead.
+ * 
+ * \note The script on the neighbour must be the same, because Addresses are sent as offsets into the script.
+ */
+class ExportDecoder {
+	
+	protected:
+		Script script;
+		NumberFormat const * number_formats;
+		Size format_count;
+		
+		// Reset the imports in [from, to) that are set.
+		static inline void reset(NeighbourHood & hood, NeighbourHood::iterator neighbour, Index from, Index to) {
+			for(Index i = from; i < to; i++) if (neighbour->imports[i].isSet()) hood.update(neighbour, i, Data());
+		}
+		
+		// A sender in a batch of messages (see decode(NeighbourHood &, NeighbourMessage const *, Size, Time)), in a slot of a hash table.
+		struct Sender {
+			MachineId id;
+			Index last; // One more than the index of the last message from this sender, or zero for an unused slot.
+			Index first; // The index of the first message from this sender.
+			Index last_full; // One more than the index of the last full message from this sender, or of the first message when there is no full one.
+			NeighbourHood::iterator neighbour; // The Neighbour of this sender, when present.
+			bool present; // Whether the sender has a Neighbour: found before the batch, or added when heard.
+			bool heard; // Whether NeighbourHood::heard() was called for this sender already.
+			Size evictions; // The number of evictions in this batch when neighbour was found. A later eviction can have moved it.
+		};
+	
+	public:
+		/// The constructor.
+		/**
+		 * \param script The script running on the machine, which the received Addresses point into.
+		 */
+		inline explicit ExportDecoder(Script script = Script()) : script(script), number_formats(0), format_count(0) {}
+		
+		/// Read Addresses as offsets into the given script from now on, such as after installing another script.
+		inline void use(Script script) {
+			this->script = script;
+		}
+		
+		/// Read the Numbers of the first \a count exports in the given formats, which must be the ones given to ExportEncoder::formats().
+		inline void formats(NumberFormat const * formats, Size count) {
+			number_formats = formats;
+			format_count = count;
+		}
+		
+		/// Decode a message into the imports of a Neighbour.
+		/**
+		 * \return Whether the message was valid. If not, the imports before the invalid part are already updated.
+		 */
+		inline bool decode(NeighbourHood & hood, NeighbourHood::iterator neighbour, Int8 const * message, Size length) const {
+			MessageReader reader(message, length, script);
+			Size imports = neighbour->imports.size();
+			Size kind = reader.vlq();
+			bool digested = kind & ExportEncoder::Kind_digest;
+			kind &= ~Size(ExportEncoder::Kind_digest);
+			if (kind != ExportEncoder::Kind_full && kind != ExportEncoder::Kind_delta) return false;
+			bool full = kind == ExportEncoder::Kind_full;
+#ifdef EXPORT_DIGEST
+			uint32_t digest = 0;
+			if (digested) for(Index b = 0; b < 4; b++) digest |= uint32_t(reader.byte()) << (8 * b);
+			if (reader.failed()) return false;
+			if (digested && neighbour->digest_known && neighbour->digest == digest) return true;
+			neighbour->digest_known = false;
+#else
+			if (digested) for(Index b = 0; b < 4; b++) reader.byte();
+#endif
+			Size count = reader.vlq();
+			if (count > imports) reader.fail();
+			Index next = 0;
+			for(Index c = 0; c < count && !reader.failed(); c++){
+				Index i = reader.vlq();
+				if (i < next || i >= imports){ reader.fail(); break; }
+				if (full) reset(hood, neighbour, next, i);
+				next = i + 1;
+				reader.format(i < format_count ? &number_formats[i] : 0);
+				Data * current = neighbour->imports.find(i);
+				if (current && current->type() == Data::Type_tuple && reader.peekType() == Data::Type_tuple){
+					reader.data(*current);
+					hood.changed(neighbour, i);
+				} else if (reader.peekType() == Data::Type_number){
+					reader.vlq();
+					Number number = reader.number();
+					if (!reader.failed()) hood.update(neighbour, i, number);
+				} else {
+					Data value;
+					reader.data(value);
+					if (!reader.failed()) hood.update(neighbour, i, value);
+				}
+			}
+			if (reader.failed() || reader.remaining()) return false;
+			if (full) reset(hood, neighbour, next, imports);
+#ifdef EXPORT_DIGEST
+			neighbour->digest = digest;
+			neighbour->digest_known = full && digested;
+#endif
+			return true;
+		}
+		
+		/// Decode a batch of messages from any number of neighbours.
+		/**
+		 * This does the same as calling NeighbourHood::heard() and decode() for every message in order, but with less work:
+		 *  - The messages are grouped by sender first, with a hash table, so every neighbour is heard only once, with the signal of its last message.
+		 *  - Every neighbour is looked up only once (unless a new neighbour evicted another one in the meantime).
+		 *  - Room for all new neighbours is made at once (see NeighbourHood::reserve()).
+		 *  - A message followed by a full message from the same sender is skipped, because the full message replaces all of its imports.
+		 *    When that full message turns out to be invalid, the skipped messages are decoded after all, and then the full message again,
+		 *    which leaves the imports as decoding them one at a time would.
+		 * 
+		 * \param messages The messages, in the order they were received.
+		 * \param count The number of messages.
+		 * \param now The time at which the messages were received, which becomes the Neighbour::last_heard of their senders.
+		 * \return The number of messages that were decoded and valid.
+		 */
+		inline Size decode(NeighbourHood & hood, NeighbourMessage const * messages, Size count, Time now) const {
+			if (!count) return 0;
+			// The hash table only holds one more than the index of a Sender (or zero for an empty slot), so there is little to clear.
+			Size table_capacity = 8;
+			while(table_capacity < count * 2) table_capacity *= 2;
+			Index * table = Memory<Index>::allocate(table_capacity);
+			Sender * senders = Memory<Sender>::allocate(count);
+			Index * sender_of = Memory<Index>::allocate(count);
+			for(Index i = 0; i < table_capacity; i++) table[i] = 0;
+			
+			// Group the messages by sender, and count the senders that are new.
+			Size sender_count = 0;
+			Size added = 0;
+			for(Index m = 0; m < count; m++){
+				Index i = NeighbourHood::hash(messages[m].from) & (table_capacity - 1);
+				while(table[i] && !(senders[table[i] - 1].id == messages[m].from)) i = (i + 1) & (table_capacity - 1);
+				if (!table[i]){
+					Sender & sender = senders[sender_count];
+					table[i] = ++sender_count;
+					sender.id = messages[m].from;
+					sender.first = m;
+					sender.last_full = m + 1;
+					sender.neighbour = hood.find(messages[m].from);
+					sender.present = sender.neighbour != hood.end();
+					sender.heard = false;
+					sender.evictions = 0;
+					if (!sender.present) added++;
+				}
+				Sender & sender = senders[table[i] - 1];
+				sender.last = m + 1;
+				if (messages[m].size && (Size(messages[m].data[0]) & ~Size(ExportEncoder::Kind_digest)) == ExportEncoder::Kind_full) sender.last_full = m + 1;
+				sender_of[m] = table[i] - 1;
+			}
+			if (added) hood.reserve(hood.size() + added);
+			
+			// Reserving does not move any Neighbour, so the ones found above are still valid.
+			Size decoded = 0;
+			Size evictions = 0;
+			for(Index m = 0; m < count; m++){
+				Sender & sender = senders[sender_of[m]];
+				if (m + 1 < sender.last_full) continue;
+				if (sender.present && sender.evictions != evictions){
+					sender.neighbour = hood.find(sender.id);
+					sender.present = sender.neighbour != hood.end();
+					sender.evictions = evictions;
+				}
+				if (!sender.heard){
+					sender.heard = true;
+					Int8 signal = messages[sender.last - 1].signal;
+					if (sender.present){
+						hood.heard(sender.neighbour, now, signal);
+					} else {
+						Size size = hood.size();
+						sender.neighbour = hood.heardNew(sender.id, now, signal);
+						sender.present = sender.neighbour != hood.end();
+						if (sender.present && hood.size() == size) evictions++;
+						sender.evictions = evictions;
+					}
+				}
+				if (!sender.present) continue;
+				if (decode(hood, sender.neighbour, messages[m].data, messages[m].size)){
+					decoded++;
+				} else if (m + 1 == sender.last_full && sender.first < m){
+					for(Index e = sender.first; e < m; e++){
+						if (sender_of[e] == sender_of[m] && decode(hood, sender.neighbour, messages[e].data, messages[e].size)) decoded++;
+					}
+					decode(hood, sender.neighbour, messages[m].data, messages[m].size);
+				}
+			}
+			
+			Memory<Index>::deallocate(sender_of, count);
+			Memory<Sender>::deallocate(senders, count);
+			Memory<Index>::deallocate(table, table_capacity);
+			return decoded;
+		}
+	
+};
+
+#endif
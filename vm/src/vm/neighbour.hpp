@@ -16,7 +16,43 @@
 
 #include <array.hpp>
 #include <data.hpp>
+#include <importrow.hpp>
 #include <machineid.hpp>
+#include <time.hpp>
+
+/// The imports of a Neighbour.
+/**
+ * The imports are not stored in the Neighbour itself, but in the ImportRows of the NeighbourHood,
+ * which store the imports of all neighbours for the same export together.
+ * This refers to the imports of a single Neighbour in those rows.
+ */
+class Imports {
+	
+	protected:
+		ImportRow * rows;
+		Index position;
+		Size count;
+		
+	public:
+		/// Refer to the imports at the given position in \a count rows.
+		inline explicit Imports(ImportRow * rows = 0, Index position = 0, Size count = 0) : rows(rows), position(position), count(count) {}
+		
+		/// Constant access to an import, which is not set when there is no value for it.
+		/**
+		 * \see NeighbourHood::update() to change an import.
+		 */
+		inline Data const & operator [] (Index index) const { return rows[index][position]; }
+		
+		/// Access to an import that has a value, or 0 when there is none.
+		/**
+		 * \warning The import must stay set, and changes are not noticed by the NeighbourHood (see NeighbourHood::update()).
+		 */
+		inline Data * find(Index index) { return rows[index].find(position); }
+		
+		/// The number of imports.
+		inline Size size() const { return count; }
+		
+};
 
 class BasicNeighbour {
 	
@@ -27,9 +63,51 @@ class BasicNeighbour {
 		
 		/// The imports from this machine.
 		/** \memberof Neighbour */
-		Array<Data> imports;
+		Imports imports;
 		
-		BasicNeighbour(MachineId const & id, Size imports) : id(id), imports(imports) {}
+		/// The time at which this machine was last heard from, when last_heard_known.
+		/**
+		 * \see NeighbourHood::heard()
+		 * \see NeighbourHood::expire()
+		 */
+		/** \memberof Neighbour */
+		Time last_heard;
+		
+		/// Whether last_heard is set.
+		/**
+		 * A Neighbour added without being heard from (by NeighbourHood::add() or NeighbourHood::operator[]) does not know its last_heard yet.
+		 * The next NeighbourHood::expire() then sets it to the current time instead of removing the Neighbour,
+		 * so that it lasts for a full timeout.
+		 */
+		/** \memberof Neighbour */
+		bool last_heard_known;
+		
+		/// The signal quality (higher is better) of the last message from this machine.
+		/**
+		 * Used to pick a Neighbour to evict with \c HOOD_EVICT_WEAKEST.
+		 * \see NeighbourHood::heard()
+		 */
+		/** \memberof Neighbour */
+		Int8 signal;
+		
+#ifdef EXPORT_DIGEST
+		/// The export digest (see Machine::exportDigest()) of the imports from this machine, when digest_known.
+		/**
+		 * Set by ExportDecoder::decode() for a full message with a digest, so that it can skip the next messages with the same digest.
+		 */
+		/** \memberof Neighbour */
+		uint32_t digest;
+		
+		/// Whether the imports are known to be the exports with the digest.
+		/** \memberof Neighbour */
+		bool digest_known;
+		
+#endif
+		BasicNeighbour(MachineId const & id, Imports const & imports) : id(id), imports(imports), last_heard(0), last_heard_known(false), signal(0)
+#ifdef EXPORT_DIGEST
+			, digest(0), digest_known(false)
+#endif
+		{}
 		
 };
 
@@ -51,7 +129,7 @@ class Neighbour : public ExtendedNeighbour {
 	
 	public:
 		/// The constructor.
-		Neighbour(MachineId const & id, Size imports) : ExtendedNeighbour(id, imports) {}
+		Neighbour(MachineId const & id, Imports const & imports) : ExtendedNeighbour(id, imports) {}
 		
 };
 
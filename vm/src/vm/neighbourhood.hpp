@@ -11,6 +11,8 @@
 /// \file
 /// Provides the NeighbourHood class.
 
+#include <stdint.h>
+
 #ifndef __NEIGHBOURLIST_HPP
 #define __NEIGHBOURLIST_HPP
 
@@ -18,10 +20,58 @@
 #include <types.hpp>
 #include <neighbour.hpp>
 
+/** \cond */
+#define HOOD_EVICT_OLDEST  0
+#define HOOD_EVICT_WEAKEST 1
+#define HOOD_EVICT_RANDOM  2
+
+#ifndef HOOD_EVICTION
+#define HOOD_EVICTION HOOD_EVICT_OLDEST
+#endif
+
+#ifndef HOOD_CAPACITY
+#define HOOD_CAPACITY 0
+#endif
+
+#if HOOD_EVICTION == HOOD_EVICT_WEAKEST
+#define HOOD_SIGNAL_LEVELS 32
+#else
+#define HOOD_SIGNAL_LEVELS 1
+#endif
+/** \endcond */
+
+#if defined(HOOD_SIMD) && defined(FIXED_POINT_NUMBER)
+#error HOOD_SIMD can not be used together with FIXED_POINT_NUMBER.
+#endif
+
 /// A list of Neighbours.
 /**
- * This implements a doubly linked list.
- * Though, it could be replaced by any other implementation (raw array, tree set, etc.), as long as it has the same public interface.
+ * The Neighbours are stored next to each other in a single array, and their imports in an ImportRow per export (see row()),
+ * which is sparse or dense depending on how many of the Neighbours have a value for it.
+ * Removing a Neighbour moves the last one to its place, so the order of the Neighbours is not preserved,
+ * except that the first one stays the first one (see Machine::thisMachine()).
+ * 
+ * A hash table (open addressing, linear probing) indexes the Neighbours by MachineId.
+ * Looking up a Neighbour by its ID (find() and operator[]) takes constant time on average.
+ * 
+ * The number of Neighbours can be limited (see limit()), to \c HOOD_CAPACITY by default (no limit when it is zero or not defined).
+ * When the NeighbourHood is full, adding a Neighbour first evicts another one, picked in constant time by the policy selected by \c HOOD_EVICTION:
+ *  - \c HOOD_EVICT_OLDEST (the default): the Neighbour that was heard from least recently.
+ *  - \c HOOD_EVICT_WEAKEST: the Neighbour with the lowest Neighbour::signal, and of those the one that was heard from least recently.
+ *    The signal is divided in 32 levels, and a new Neighbour that is weaker than all others is not admitted at all (see heard()).
+ *  - \c HOOD_EVICT_RANDOM: a random Neighbour.
+ * 
+ * The first Neighbour (this machine) is never evicted.
+ * 
+ * When \c INCREMENTAL_FOLD is defined, the changes of the imports are tracked (see update()), so that FOLD_HOOD can skip the imports that did not change.
+ * 
+ * When \c HOOD_SIMD is defined, the imports that are Numbers are also kept in a matrix of plain Numbers (see numbers()),
+ * so that they can be reduced with vector instructions (see Reduce).
+ * 
+ * Though, it could be replaced by any other implementation (linked list, tree set, etc.), as long as it has the same public interface.
+ * 
+ * \warning Adding a Neighbour may move all Neighbours and imports, and removing one moves the last one.
+ *          Iterators stay valid (except for the removed and the last Neighbour), but references to Neighbours and imports do not.
  * 
  * \todo Add documentation and some examples.
  */
@@ -29,72 +79,372 @@ class NeighbourHood {
 	
 	protected:
 		
-		struct NeighbourHoodElement {
-			Neighbour neighbour;
-			NeighbourHoodElement * next;
-			NeighbourHoodElement * previous;
-			inline NeighbourHoodElement(MachineId const & id, Size imports) : neighbour(id,imports), next(0), previous(0) {}
-		};
+		Neighbour * neighbours;
 		
-		NeighbourHoodElement * first;
-		NeighbourHoodElement * last;
+		// The imports, with a row for every export.
+		ImportRow * rows;
 		
-		Size list_size;
+		Size neighbours_size;
+		Size capacity;
 		
 		Size imports;
 		
+		// The hash table, with table_capacity (a power of two, or zero) slots, containing the positions (plus one, zero for empty slots) of the Neighbours.
+		Size * table;
+		Size table_capacity;
+		
+		// The maximum number of Neighbours, or zero for no limit.
+		Size maximum;
+		
+#if HOOD_EVICTION == HOOD_EVICT_RANDOM
+		uint32_t seed;
+#else
+		// The eviction order: a doubly linked list per signal level, from the least to the most recently heard Neighbour,
+		// linking positions plus one (zero for none). The first Neighbour (this machine) is not in any list.
+		Size * previous;
+		Size * following;
+		Size first[HOOD_SIGNAL_LEVELS];
+		Size last[HOOD_SIGNAL_LEVELS];
+		
+		// Bit l is set when list l is not empty.
+		uint32_t levels;
+		
+		static inline Index level(Int8 signal) {
+			return Size(signal) * HOOD_SIGNAL_LEVELS / 256;
+		}
+		
+		inline void link(Index position) {
+			Index l = level(neighbours[position].signal);
+			previous[position] = last[l];
+			following[position] = 0;
+			if (last[l]) following[last[l] - 1] = position + 1;
+			else first[l] = position + 1;
+			last[l] = position + 1;
+			levels |= uint32_t(1) << l;
+		}
+		
+		inline void unlink(Index position) {
+			Index l = level(neighbours[position].signal);
+			if (previous[position]) following[previous[position] - 1] = following[position];
+			else first[l] = following[position];
+			if (following[position]) previous[following[position] - 1] = previous[position];
+			else last[l] = previous[position];
+			if (!first[l]) levels &= ~(uint32_t(1) << l);
+		}
+		
+		// Give the Neighbour moved from one position to another the same place in the eviction order.
+		inline void relink(Index from, Index to) {
+			Index l = level(neighbours[to].signal);
+			previous[to] = previous[from];
+			following[to] = following[from];
+			if (previous[to]) following[previous[to] - 1] = to + 1;
+			else first[l] = to + 1;
+			if (following[to]) previous[following[to] - 1] = to + 1;
+			else last[l] = to + 1;
+		}
+		
+		// The lowest signal level that has any Neighbours (only valid when levels is not zero).
+		inline Index lowest() const {
+			Index l = 0;
+			while(!(levels & (uint32_t(1) << l))) l++;
+			return l;
+		}
+#endif
+		
+#ifdef INCREMENTAL_FOLD
+		// The dirty bits of the Neighbours: bit k is set when import k changed since the last clean(k).
+		uint32_t * dirty_bits;
+		
+		// The changes of an import.
+		struct Changes {
+			Counter version;   // Incremented by every change.
+			Counter cleaned;   // The version at the last clean().
+			bool    additions; // Whether all changes since the last clean() gave a value to an import that was not set.
+		};
+		Changes * changes;
+		
+		inline void change(Index import, bool addition) {
+			changes[import].version++;
+			if (!addition) changes[import].additions = false;
+		}
+#endif
+		
+#ifdef HOOD_SIMD
+		// The imports in a matrix with a row of (capacity) plain Numbers for every export, with NaN for imports that are not set or not a Number.
+		Number * number_matrix;
+		
+		// The number of imports for every export that are set, but not in number_matrix.
+		Size * others;
+		
+		static inline bool plainNumber(Data const & value) {
+			return value.type() == Data::Type_number && value.asNumber() == value.asNumber();
+		}
+		
+		// Update number_matrix and others for an import that changes from one value to another.
+		inline void track(Index position, Index import, Data const & from, Data const & to) {
+			if (from.isSet() && !plainNumber(from)) others[import]--;
+			if (to.isSet() && !plainNumber(to)) others[import]++;
+			number_matrix[import * capacity + position] = plainNumber(to) ? to.asNumber() : std::numeric_limits<Number>::quiet_NaN();
+		}
+#endif
+		
+		// Remove a Neighbour to make place for a new one.
+		inline void evict() {
+#if HOOD_EVICTION == HOOD_EVICT_RANDOM
+			seed = seed * 1103515245u + 12345u;
+			remove(iterator(this, 1 + (seed >> 8) % (neighbours_size - 1)));
+#else
+			remove(iterator(this, first[lowest()] - 1));
+#endif
+		}
+		
+		inline bool full() const {
+			return maximum && neighbours_size >= maximum && neighbours_size > 1;
+		}
+		
+		inline Size home(MachineId const & id) const {
+			return hash(id) & (table_capacity - 1);
+		}
+		
+		inline void insert(Index position) {
+			Index i = home(neighbours[position].id);
+			while(table[i]) i = (i + 1) & (table_capacity - 1);
+			table[i] = position + 1;
+		}
+		
+		inline void rehash(Size new_capacity) {
+			if (table) Memory<Size>::deallocate(table, table_capacity);
+			table = Memory<Size>::allocate(new_capacity);
+			table_capacity = new_capacity;
+			for(Index i = 0; i < table_capacity; i++) table[i] = 0;
+			for(Index p = 0; p < neighbours_size; p++) insert(p);
+		}
+		
+		// The position of the Neighbour with the given ID, or neighbours_size if there is none.
+		inline Index lookup(MachineId const & id) const {
+			if (!table_capacity) return neighbours_size;
+			for(Index i = home(id); table[i]; i = (i + 1) & (table_capacity - 1)){
+				if (neighbours[table[i] - 1].id == id) return table[i] - 1;
+			}
+			return neighbours_size;
+		}
+		
+		// The slot in the hash table of the Neighbour at the given position.
+		inline Index find_slot(Index position) const {
+			Index i = home(neighbours[position].id);
+			while(table[i] != position + 1) i = (i + 1) & (table_capacity - 1);
+			return i;
+		}
+		
+		// Remove a Neighbour from the hash table, shifting back the elements after it to keep the probe sequences intact.
+		inline void unindex(Index position) {
+			Size mask = table_capacity - 1;
+			Index hole = find_slot(position);
+			for(Index i = (hole + 1) & mask; table[i]; i = (i + 1) & mask){
+				Index h = home(neighbours[table[i] - 1].id);
+				if (((i - h) & mask) >= ((i - hole) & mask)){
+					table[hole] = table[i];
+					hole = i;
+				}
+			}
+			table[hole] = 0;
+		}
+		
+		// Point the imports of the Neighbour at the given position to its position in the rows.
+		inline void bind(Index position) {
+			neighbours[position].imports = Imports(rows, position, imports);
+		}
+		
+		inline void grow() {
+			Size new_capacity = capacity ? capacity * 2 : 4;
+			if (maximum > capacity && new_capacity > maximum) new_capacity = maximum;
+			grow(new_capacity);
+		}
+		
+		inline void grow(Size new_capacity) {
+			Neighbour * new_neighbours = Memory<Neighbour>::allocate(new_capacity);
+			for(Index k = 0; k < imports; k++) rows[k].resize(new_capacity);
+#ifdef HOOD_SIMD
+			Number * new_number_matrix = imports ? Memory<Number>::allocate(imports * new_capacity) : 0;
+			for(Index k = 0; k < imports; k++){
+				for(Index i = 0; i < new_capacity; i++){
+					new_number_matrix[k * new_capacity + i] = i < neighbours_size ? number_matrix[k * capacity + i] : std::numeric_limits<Number>::quiet_NaN();
+				}
+			}
+#endif
+			for(Index i = 0; i < neighbours_size; i++){
+				new (&new_neighbours[i]) Neighbour(neighbours[i]);
+				neighbours[i].~Neighbour();
+			}
+#if HOOD_EVICTION != HOOD_EVICT_RANDOM
+			Size * new_previous = Memory<Size>::allocate(new_capacity);
+			Size * new_following = Memory<Size>::allocate(new_capacity);
+			for(Index i = 0; i < neighbours_size; i++){
+				new_previous[i] = previous[i];
+				new_following[i] = following[i];
+			}
+#endif
+#ifdef INCREMENTAL_FOLD
+			uint32_t * new_dirty_bits = Memory<uint32_t>::allocate(new_capacity);
+			for(Index i = 0; i < neighbours_size; i++) new_dirty_bits[i] = dirty_bits[i];
+#endif
+			release();
+#if HOOD_EVICTION != HOOD_EVICT_RANDOM
+			previous = new_previous;
+			following = new_following;
+#endif
+#ifdef INCREMENTAL_FOLD
+			dirty_bits = new_dirty_bits;
+#endif
+#ifdef HOOD_SIMD
+			number_matrix = new_number_matrix;
+#endif
+			neighbours = new_neighbours;
+			capacity = new_capacity;
+		}
+		
+		// Deallocate the Neighbours (which must already be destructed) and everything else of (capacity) elements.
+		inline void release() {
+			if (neighbours) Memory<Neighbour>::deallocate(neighbours, capacity);
+#if HOOD_EVICTION != HOOD_EVICT_RANDOM
+			if (previous) Memory<Size>::deallocate(previous, capacity);
+			if (following) Memory<Size>::deallocate(following, capacity);
+			previous = 0;
+			following = 0;
+#endif
+#ifdef INCREMENTAL_FOLD
+			if (dirty_bits) Memory<uint32_t>::deallocate(dirty_bits, capacity);
+			dirty_bits = 0;
+#endif
+#ifdef HOOD_SIMD
+			if (number_matrix) Memory<Number>::deallocate(number_matrix, imports * capacity);
+			number_matrix = 0;
+#endif
+			neighbours = 0;
+		}
+	
+	private:
+		NeighbourHood(NeighbourHood const &);
+		NeighbourHood & operator = (NeighbourHood const &);
+	
 	public:
 		
 		class iterator {
 			protected:
-				NeighbourHoodElement * element;
-				inline iterator(NeighbourHoodElement * element) : element(element) {}
+				NeighbourHood * hood;
+				Index position;
+				inline iterator(NeighbourHood * hood, Index position) : hood(hood), position(position) {}
 				friend class const_iterator;
 				friend class NeighbourHood;
 			public:
 				inline iterator() {}
-				inline iterator & operator ++ (     ) {                     element = element->next    ; return *this; }
-				inline iterator   operator ++ (int x) { iterator i = *this; element = element->next    ; return  i   ; }
-				inline iterator & operator -- (     ) {                     element = element->previous; return *this; }
-				inline iterator   operator -- (int x) { iterator i = *this; element = element->previous; return  i   ; }
-				inline Neighbour & operator *  () const { return   element->neighbour ; }
-				inline Neighbour * operator -> () const { return &(element->neighbour); }
-				inline bool operator == (iterator const & i) const { return element == i.element; }
-				inline bool operator != (iterator const & i) const { return element != i.element; }
-				inline operator Neighbour * () const { return &(element->neighbour); }
+				inline iterator & operator ++ (     ) {                     position++; return *this; }
+				inline iterator   operator ++ (int x) { iterator i = *this; position++; return  i   ; }
+				inline iterator & operator -- (     ) {                     position--; return *this; }
+				inline iterator   operator -- (int x) { iterator i = *this; position--; return  i   ; }
+				inline Neighbour & operator *  () const { return   hood->neighbours[position] ; }
+				inline Neighbour * operator -> () const { return &(hood->neighbours[position]); }
+				inline bool operator == (iterator const & i) const { return position == i.position && hood == i.hood; }
+				inline bool operator != (iterator const & i) const { return position != i.position || hood != i.hood; }
+				inline operator Neighbour * () const { return &(hood->neighbours[position]); }
+				inline Index index() const { return position; } ///< The position of the Neighbour, as used by row().
 		};
 		
 		class const_iterator {
 			protected:
-				NeighbourHoodElement const * element;
-				inline const_iterator(NeighbourHoodElement const * element) : element(element) {}
-				inline const_iterator(iterator const & i) : element(i.element) {}
+				NeighbourHood const * hood;
+				Index position;
+				inline const_iterator(NeighbourHood const * hood, Index position) : hood(hood), position(position) {}
+				inline const_iterator(iterator const & i) : hood(i.hood), position(i.position) {}
 				friend class NeighbourHood;
 			public:
 				inline const_iterator() {}
-				inline const_iterator & operator ++ (     ) {                           element = element->next    ; return *this; }
-				inline const_iterator   operator ++ (int x) { const_iterator i = *this; element = element->next    ; return  i   ; }
-				inline const_iterator & operator -- (     ) {                           element = element->previous; return *this; }
-				inline const_iterator   operator -- (int x) { const_iterator i = *this; element = element->previous; return  i   ; }
-				inline Neighbour const & operator *  () const { return   element->neighbour ; }
-				inline Neighbour const * operator -> () const { return &(element->neighbour); }
-				inline bool operator == (const_iterator const & i) const { return element == i.element; }
-				inline bool operator != (const_iterator const & i) const { return element != i.element; }
-				inline operator Neighbour const * () const { return &(element->neighbour); }
+				inline const_iterator & operator ++ (     ) {                           position++; return *this; }
+				inline const_iterator   operator ++ (int x) { const_iterator i = *this; position++; return  i   ; }
+				inline const_iterator & operator -- (     ) {                           position--; return *this; }
+				inline const_iterator   operator -- (int x) { const_iterator i = *this; position--; return  i   ; }
+				inline Neighbour const & operator *  () const { return   hood->neighbours[position] ; }
+				inline Neighbour const * operator -> () const { return &(hood->neighbours[position]); }
+				inline bool operator == (const_iterator const & i) const { return position == i.position && hood == i.hood; }
+				inline bool operator != (const_iterator const & i) const { return position != i.position || hood != i.hood; }
+				inline operator Neighbour const * () const { return &(hood->neighbours[position]); }
+				inline Index index() const { return position; } ///< The position of the Neighbour, as used by row().
 		};
 		
-		explicit inline NeighbourHood(Size imports = 0) : first(0), last(0), list_size(0), imports(imports) {}
+		explicit inline NeighbourHood(Size imports = 0) : neighbours(0), rows(0), neighbours_size(0), capacity(0), imports(0), table(0), table_capacity(0), maximum(HOOD_CAPACITY),
+#if HOOD_EVICTION == HOOD_EVICT_RANDOM
+			seed(1)
+#else
+			previous(0), following(0), levels(0)
+#endif
+#ifdef INCREMENTAL_FOLD
+			, dirty_bits(0), changes(0)
+#endif
+#ifdef HOOD_SIMD
+			, number_matrix(0), others(0)
+#endif
+		{
+#if HOOD_EVICTION != HOOD_EVICT_RANDOM
+			for(Index l = 0; l < HOOD_SIGNAL_LEVELS; l++) first[l] = last[l] = 0;
+#endif
+			reset(imports);
+		}
+		
+		inline ~NeighbourHood() {
+			reset(0);
+		}
 		
+#ifdef STATIC_MEMORY
+		/// The number of bytes reset() allocates for a number of imports, which Machine::reserve() reserves in the StaticMemory.
+		static inline Size bytes(Size imports) {
+			Size bytes = StaticMemory::bytes<ImportRow>(imports);
+#ifdef INCREMENTAL_FOLD
+			bytes += StaticMemory::bytes<Changes>(imports);
+#endif
+#ifdef HOOD_SIMD
+			bytes += StaticMemory::bytes<Size>(imports);
+#endif
+			return bytes;
+		}
+		
+#endif
 		inline void reset(Size imports){
-			iterator i = first;
-			while(i != end()) i = remove(i);
+			for(Index i = 0; i < neighbours_size; i++) neighbours[i].~Neighbour();
+			release();
+			for(Index k = 0; k < this->imports; k++) rows[k].~ImportRow();
+			if (rows) Memory<ImportRow>::deallocate(rows, this->imports);
+			rows = imports ? Memory<ImportRow>::allocate(imports) : 0;
+			for(Index k = 0; k < imports; k++) new (&rows[k]) ImportRow();
+			if (table) Memory<Size>::deallocate(table, table_capacity);
+			table = 0;
+			table_capacity = 0;
+			neighbours_size = 0;
+			capacity = 0;
+			maximum = HOOD_CAPACITY;
+#if HOOD_EVICTION != HOOD_EVICT_RANDOM
+			for(Index l = 0; l < HOOD_SIGNAL_LEVELS; l++) first[l] = last[l] = 0;
+			levels = 0;
+#endif
+#ifdef INCREMENTAL_FOLD
+			if (changes) Memory<Changes>::deallocate(changes, this->imports);
+			changes = imports ? Memory<Changes>::allocate(imports) : 0;
+			for(Index k = 0; k < imports; k++){
+				changes[k].version = changes[k].cleaned = 0;
+				changes[k].additions = true;
+			}
+#endif
+#ifdef HOOD_SIMD
+			if (others) Memory<Size>::deallocate(others, this->imports);
+			others = imports ? Memory<Size>::allocate(imports) : 0;
+			for(Index k = 0; k < imports; k++) others[k] = 0;
+#endif
 			this->imports = imports;
 		}
 		
-		inline       iterator begin()       { return first; }
-		inline const_iterator begin() const { return first; }
-		inline       iterator end  ()       { return 0    ; }
-		inline const_iterator end  () const { return 0    ; }
+		inline       iterator begin()       { return       iterator(this, 0); }
+		inline const_iterator begin() const { return const_iterator(this, 0); }
+		inline       iterator end  ()       { return       iterator(this, neighbours_size); }
+		inline const_iterator end  () const { return const_iterator(this, neighbours_size); }
 		
 		inline Neighbour const & operator [] (MachineId const & id) const {
 			return *find(id);
@@ -105,43 +455,274 @@ class NeighbourHood {
 			return *(i == end() ? add(id) : i);
 		}
 		
+		/// The hash of a MachineId, as used to look up Neighbours. IDs that compare equal get the same hash.
+		static inline Size hash(MachineId const & id) {
+			MachineId key = id == MachineId(0) ? MachineId(0) : id; // Make sure -0 and 0 get the same hash.
+			Int8 const * bytes = reinterpret_cast<Int8 const *>(&key);
+			uint32_t h = 2166136261u; // FNV-1a
+			for(Index i = 0; i < sizeof(MachineId); i++) h = (h ^ bytes[i]) * 16777619u;
+			return h ^ (h >> 16);
+		}
+		
 		inline iterator find(MachineId const & id) {
-			for(iterator i = begin(); i != end(); i++) if (i->id == id) return i;
-			return end();
+			return iterator(this, lookup(id));
 		}
 		
 		inline const_iterator find(MachineId const & id) const {
-			for(const_iterator i = begin(); i != end(); i++) if (i->id == id) return i;
-			return end();
+			return const_iterator(this, lookup(id));
 		}
 		
+		/// Add a Neighbour, evicting another one first when the NeighbourHood is full.
+		/**
+		 * The Neighbour has not been heard from yet, so the next expire() does not remove it (see Neighbour::last_heard_known).
+		 *
+		 * \warning The ID must not be in the NeighbourHood already.
+		 */
 		inline iterator add(MachineId const & id) {
-			NeighbourHoodElement * n = Memory<NeighbourHoodElement>::allocate();
-			new (n) NeighbourHoodElement(id,imports);
-			if (last) last->next = n;
-			n->previous = last;
-			last = n;
-			if (!first) first = n;
-			list_size++;
-			return n;
+			if (full()) evict();
+			if (neighbours_size == capacity) grow();
+			Index position = neighbours_size++;
+			new (&neighbours[position]) Neighbour(id, Imports(rows, position, imports));
+			if (neighbours_size * 2 > table_capacity) rehash(table_capacity ? table_capacity * 2 : 8);
+			else insert(position);
+#if HOOD_EVICTION != HOOD_EVICT_RANDOM
+			if (position) link(position);
+#endif
+#ifdef INCREMENTAL_FOLD
+			dirty_bits[position] = 0;
+#endif
+			return iterator(this, position);
 		}
 		
 		inline iterator remove(iterator neighbour) {
-			NeighbourHoodElement * n = neighbour.element;
-			if (n->previous) n->previous->next = n->next;
-			if (n->next    ) n->next->previous = n->previous;
-			if (n == first) first = n->next;
-			if (n == last ) last  = n->previous;
-			iterator next = n->next;
-			n->~NeighbourHoodElement();
-			Memory<NeighbourHoodElement>::deallocate(n);
-			list_size--;
-			return next;
+			Index position = neighbour.position;
+			Index last = neighbours_size - 1;
+			unindex(position);
+#if HOOD_EVICTION != HOOD_EVICT_RANDOM
+			if (position) unlink(position);
+			else if (last) unlink(last);
+#endif
+#ifdef INCREMENTAL_FOLD
+			for(Index k = 0; k < imports; k++) if (rows[k][position].isSet()) change(k, false);
+#endif
+#ifdef HOOD_SIMD
+			for(Index k = 0; k < imports; k++) track(position, k, rows[k][position], Data());
+#endif
+			for(Index k = 0; k < imports; k++) rows[k].remove(position, capacity);
+			if (position != last){
+				table[find_slot(last)] = position + 1;
+				neighbours[position].~Neighbour();
+				new (&neighbours[position]) Neighbour(neighbours[last]);
+				bind(position);
+				for(Index k = 0; k < imports; k++) rows[k].move(last, position);
+#ifdef HOOD_SIMD
+				for(Index k = 0; k < imports; k++) number_matrix[k * capacity + position] = number_matrix[k * capacity + last];
+#endif
+#if HOOD_EVICTION != HOOD_EVICT_RANDOM
+				if (position) relink(last, position);
+#endif
+#ifdef INCREMENTAL_FOLD
+				dirty_bits[position] = dirty_bits[last];
+#endif
+			}
+			neighbours[last].~Neighbour();
+#ifdef HOOD_SIMD
+			for(Index k = 0; k < imports; k++) number_matrix[k * capacity + last] = std::numeric_limits<Number>::quiet_NaN();
+#endif
+			neighbours_size--;
+			return neighbour;
 		}
 		
-		inline Size size () const { return  list_size; }
-		inline bool empty() const { return !list_size; }
+		/// Record that a Neighbour has been heard from, adding it when it is new.
+		/**
+		 * \param id The ID of the Neighbour.
+		 * \param now The current time, which becomes its Neighbour::last_heard.
+		 * \param signal The signal quality of the message, which becomes its Neighbour::signal.
+		 * \return The Neighbour, or end() when it was new and not admitted (see NeighbourHood).
+		 */
+		inline iterator heard(MachineId const & id, Time now, Int8 signal = 0) {
+			iterator i = find(id);
+			return i == end() ? heardNew(id, now, signal) : heard(i, now, signal);
+		}
 		
+		/// Record that a new Neighbour has been heard from, and add it.
+		/**
+		 * This is heard() for an ID that is known not to be in the NeighbourHood, without looking it up again.
+		 * When the NeighbourHood is full, another Neighbour is evicted first, which can move one of the others (see remove()).
+		 * 
+		 * \return The Neighbour, or end() when it was not admitted (see NeighbourHood).
+		 */
+		inline iterator heardNew(MachineId const & id, Time now, Int8 signal = 0) {
+#if HOOD_EVICTION == HOOD_EVICT_WEAKEST
+			if (full() && level(signal) < lowest()) return end();
+#endif
+			return heard(add(id), now, signal);
+		}
+		
+		/// Record that a Neighbour in the NeighbourHood has been heard from.
+		/**
+		 * \see heard(MachineId const &, Time, Int8)
+		 */
+		inline iterator heard(iterator neighbour, Time now, Int8 signal = 0) {
+#if HOOD_EVICTION != HOOD_EVICT_RANDOM
+			if (neighbour.position) unlink(neighbour.position);
+#endif
+			neighbour->last_heard = now;
+			neighbour->last_heard_known = true;
+			neighbour->signal = signal;
+#if HOOD_EVICTION != HOOD_EVICT_RANDOM
+			if (neighbour.position) link(neighbour.position);
+#endif
+			return neighbour;
+		}
+		
+		/// Make room for the given number of Neighbours (including this machine), so that adding them does not reallocate.
+		/**
+		 * The room is never made larger than limit().
+		 */
+		inline void reserve(Size count) {
+			if (maximum && count > maximum) count = maximum;
+			if (count > capacity) grow(count);
+			Size new_table_capacity = table_capacity ? table_capacity : 8;
+			while(count * 2 > new_table_capacity) new_table_capacity *= 2;
+			if (new_table_capacity != table_capacity) rehash(new_table_capacity);
+		}
+		
+		/// Limit the number of Neighbours (including this machine), or remove the limit with zero.
+		/**
+		 * When there are more Neighbours already, they are evicted right away.
+		 * 
+		 * \see Instructions::DEF_HOOD
+		 */
+		inline void limit(Size maximum) {
+			this->maximum = maximum;
+			while(maximum && neighbours_size > maximum && neighbours_size > 1) evict();
+		}
+		
+		/// The maximum number of Neighbours, or zero when there is no limit.
+		inline Size limit() const {
+			return maximum;
+		}
+		
+		/// Remove all Neighbours that have not been heard from for longer than the timeout.
+		/**
+		 * This is a single pass from the last to the first Neighbour, so every Neighbour moved by a removal has already been checked,
+		 * and every removal takes constant time.
+		 * 
+		 * The first Neighbour (this machine, see Machine::thisMachine()) is never removed.
+		 * A Neighbour that was added without being heard from is not removed either, but gets the current time as its Neighbour::last_heard.
+		 * 
+		 * \return The number of removed Neighbours.
+		 */
+		inline Size expire(Time now, Time timeout) {
+			Size removed = 0;
+			for(Index i = neighbours_size; i > 1; i--){
+				Neighbour & neighbour = neighbours[i - 1];
+				if (!neighbour.last_heard_known){
+					neighbour.last_heard = now;
+					neighbour.last_heard_known = true;
+				} else if (now - neighbour.last_heard > timeout){
+					remove(iterator(this, i - 1));
+					removed++;
+				}
+			}
+			return removed;
+		}
+		
+		/// Change an import of a Neighbour.
+		/**
+		 * With \c INCREMENTAL_FOLD, the change is tracked for incremental folding,
+		 * and with \c HOOD_SIMD, the Number is stored in numbers() as well.
+		 * Imports that are changed directly instead of through this function are then not noticed.
+		 * Setting an import to the value it already has is then not a change.
+		 */
+		inline void update(iterator neighbour, Index import, Data const & value) {
+#if defined(INCREMENTAL_FOLD) || defined(HOOD_SIMD)
+			Data const & current = rows[import][neighbour.position];
+#endif
+#ifdef INCREMENTAL_FOLD
+			if (current.identical(value)) return;
+			change(import, !current.isSet());
+			if (import < 32) dirty_bits[neighbour.position] |= uint32_t(1) << import;
+#endif
+#ifdef HOOD_SIMD
+			track(neighbour.position, import, current, value);
+#endif
+			rows[import].set(neighbour.position, value, capacity);
+		}
+		
+		/// Record that an import of a Neighbour was changed directly, through Imports::find().
+		/**
+		 * This only tracks the change for incremental folding when \c INCREMENTAL_FOLD is defined.
+		 * 
+		 * \warning The import must still be of the same Data::Type, and it must not be changed from or to a Number.
+		 */
+		inline void changed(iterator neighbour, Index import) {
+#ifdef INCREMENTAL_FOLD
+			change(import, false);
+			if (import < 32) dirty_bits[neighbour.position] |= uint32_t(1) << import;
+#endif
+		}
+		
+#ifdef INCREMENTAL_FOLD
+		/// The number of changes of the imports for an export so far.
+		inline Counter version(Index import) const {
+			return changes[import].version;
+		}
+		
+		/// Check whether the only changes since the given version() gave values to imports that were not set.
+		/**
+		 * This is only known when the given version is the one of the last clean(), and only for the first 32 imports.
+		 * Those imports are the ones that are dirty().
+		 */
+		inline bool additionsSince(Index import, Counter version) const {
+			return import < 32 && changes[import].cleaned == version && changes[import].additions;
+		}
+		
+		/// Check whether an import of the Neighbour at the given position changed since the last clean().
+		inline bool dirty(Index position, Index import) const {
+			return import >= 32 || (dirty_bits[position] >> import) & 1;
+		}
+		
+		/// Mark all imports for an export as unchanged.
+		inline void clean(Index import) {
+			if (import < 32){
+				uint32_t mask = ~(uint32_t(1) << import);
+				for(Index i = 0; i < neighbours_size; i++) dirty_bits[i] &= mask;
+			}
+			changes[import].cleaned = changes[import].version;
+			changes[import].additions = true;
+		}
+#endif
+		
+		/// The Neighbour at the given position (see iterator::index()).
+		inline Neighbour       & at(Index position)       { return neighbours[position]; }
+		
+		/// Constant access to the Neighbour at the given position.
+		inline Neighbour const & at(Index position) const { return neighbours[position]; }
+		
+		/// The imports of all Neighbours for the given export, indexed by the positions of the Neighbours (see iterator::index()).
+		inline ImportRow const & row(Index import) const { return rows[import]; }
+		
+		/// The given Neighbour, or the first one after it, that has a value for the given import, or end() if there is none.
+		inline iterator next(iterator neighbour, Index import) {
+			return iterator(this, rows[import].next(neighbour.position, neighbours_size));
+		}
+		
+#ifdef HOOD_SIMD
+		/// The imports of all Neighbours for the given export as plain Numbers, indexed like row(), with NaN for the imports that are not set.
+		/**
+		 * Imports that are not a Number are NaN as well, so this can only be used when onlyNumbers() is true.
+		 */
+		inline Number const * numbers(Index import) const { return number_matrix + import * capacity; }
+		
+		/// Check whether all imports for the given export that are set are Numbers (and not NaN), so that numbers() has all of them.
+		inline bool onlyNumbers(Index import) const { return !others[import]; }
+#endif
+		
+		inline Size size () const { return  neighbours_size; }
+		inline bool empty() const { return !neighbours_size; }
+	
 };
 
 #endif
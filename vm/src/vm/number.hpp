@@ -0,0 +1,36 @@
+/*   ____       _  __ _   ____            _
+ *  |  _ \  ___| |/ _| |_|  _ \ _ __ ___ | |_ ___
+ *  | | | |/ _ \ | |_| __| |_) | '__/ _ \| __/ _ \
+ *  | |_| |  __/ |  _| |_|  __/| | ( (_) | |( (_) )
+ *  |____/ \___|_|_|  \__|_|   |_|  \___/ \__\___/
+ *
+ * This file is part of DelftProto.
+ * See COPYING for license details.
+ */
+
+
+/// \file
+/// Provides conversions of a Number to the built-in types, for both a \c float and a Fixed Number.
+
+#ifndef __NUMBER_HPP
+#define __NUMBER_HPP
+
+#include <types.hpp>
+
+#ifdef FIXED_POINT_NUMBER
+
+/// Convert a Number to an integer, truncating towards zero.
+inline long toInteger(Number number) { return number.toInt(); }
+
+/// Convert a Number to a \c double.
+inline double toDouble(Number number) { return number.toDouble(); }
+
+#else
+
+inline long toInteger(Number number) { return long(number); }
+
+inline double toDouble(Number number) { return double(number); }
+
+#endif
+
+#endif
@@ -0,0 +1,317 @@
+/*   ____       _  __ _   ____            _
+ *  |  _ \  ___| |/ _| |_|  _ \ _ __ ___ | |_ ___
+ *  | | | |/ _ \ | |_| __| |_) | '__/ _ \| __/ _ \
+ *  | |_| |  __/ |  _| |_|  __/| | ( (_) | |( (_) )
+ *  |____/ \___|_|_|  \__|_|   |_|  \___/ \__\___/
+ *
+ * This file is part of DelftProto.
+ * See COPYING for license details.
+ */
+
+/// \file
+/// Provides the Pool and PoolMemory classes.
+
+extern "C" {
+#	include <stdlib.h>
+}
+
+#ifndef __POOL_HPP
+#define __POOL_HPP
+
+#include <types.hpp>
+
+#ifdef STATIC_MEMORY
+#include <staticmemory.hpp>
+#endif
+
+/** \cond */
+#ifndef POOL_GRANULE
+#define POOL_GRANULE (2 * sizeof(void *))
+#endif
+
+#ifndef POOL_MAX_SIZE
+#define POOL_MAX_SIZE 128
+#endif
+
+#ifndef POOL_CHUNK_SIZE
+#ifdef STATIC_MEMORY
+#define POOL_CHUNK_SIZE 256
+#else
+#define POOL_CHUNK_SIZE 4096
+#endif
+#endif
+/** \endcond */
+
+/// A memory pool with a free list per size class.
+/**
+ * Allocations up to \c POOL_MAX_SIZE bytes are rounded up to a multiple of \c POOL_GRANULE bytes (the size class),
+ * and are taken from the free list of that size class.
+ * When a free list is empty, a chunk of about \c POOL_CHUNK_SIZE bytes is requested from the system and split into blocks of that size class.
+ * Deallocated blocks go back to the free list of their size class, and chunks are never given back to the system.
+ *
+ * Larger allocations are passed on to the system allocator directly.
+ *
+ * When \c STATIC_MEMORY is defined, the chunks and the larger allocations are taken from the StaticMemory instead.
+ * Every larger allocation then starts with a header with its real size.
+ * Deallocated larger allocations are kept in a list sorted by address, in which adjacent blocks are merged,
+ * and the block at the top of the StaticMemory (see StaticMemory::give()) is given back.
+ * An allocation takes the smallest block that fits, and splits off what it does not need when that is more than \c POOL_MAX_SIZE bytes,
+ * so allocations that grow in varying steps (such as NeighbourHood::grow()) reuse the memory they give back.
+ * A chunk that does not fit is replaced by a single block.
+ * Running out of memory is handled by StaticMemory::exhausted(), after which the allocation is tried again with the spare,
+ * and the VM aborts only when that fails as well.
+ * Allocations made during a StaticMemory::Reservation are passed on to StaticMemory::reserve().
+ *
+ * All three sizes can be overridden by defining them before including this file (e.g. on the command line). The chunk size defaults to 256 bytes with \c STATIC_MEMORY.
+ * The defaults are sized for tuple headers, element arrays of up to eight elements and small NeighbourHoods.
+ *
+ * \note The size of a deallocated block is derived from the capacity given to Memory::deallocate,
+ *       so it must be the same as the capacity given to Memory::allocate.
+ */
+class Pool {
+	
+	public:
+		/// The number of size classes.
+		static const Size classes = (POOL_MAX_SIZE + POOL_GRANULE - 1) / POOL_GRANULE;
+		
+		/// Memory usage statistics.
+		struct Statistics {
+			Size reserved;  ///< The number of bytes in chunks obtained from the system.
+			Size used;      ///< The number of bytes in blocks that are in use.
+			Size requested; ///< The number of bytes requested for the blocks that are in use.
+			Size large;     ///< The number of bytes in use for allocations that were too large for the pool.
+			Size blocks;    ///< The number of blocks in use.
+			Size chunks;    ///< The number of chunks obtained from the system.
+			
+			/// The bytes lost to rounding up to the size classes.
+			inline Size internalFragmentation() const { return used - requested; }
+			
+			/// The bytes reserved by the pool, but not in use.
+			inline Size externalFragmentation() const { return reserved - used; }
+		};
+	
+	protected:
+		struct Block {
+			Block * next;
+		};
+		
+#ifdef STATIC_MEMORY
+		// The header of a larger allocation, and a deallocated one in the list.
+		struct LargeBlock {
+			LargeBlock * next;
+			Size bytes; // Including the header.
+		};
+		
+		static inline Size header() {
+			return StaticMemory::bytes<LargeBlock>(1);
+		}
+#endif
+		
+		struct State {
+			Block * free[classes];
+			Size in_use[classes];
+#ifdef STATIC_MEMORY
+			LargeBlock * large;
+#endif
+			Statistics statistics;
+			State() : statistics() {
+				for(Index i = 0; i < classes; i++){ free[i] = 0; in_use[i] = 0; }
+#ifdef STATIC_MEMORY
+				large = 0;
+#endif
+			}
+		};
+		
+		static inline State & state() {
+			static State s;
+			return s;
+		}
+		
+		static inline Index sizeClass(Size bytes) {
+			return bytes ? (bytes - 1) / POOL_GRANULE : 0;
+		}
+		
+		static inline Size classSize(Index size_class) {
+			return (size_class + 1) * POOL_GRANULE;
+		}
+		
+		static inline void * system(Size bytes) {
+#ifdef STATIC_MEMORY
+			return StaticMemory::take(bytes);
+#else
+			return malloc(bytes);
+#endif
+		}
+		
+#ifdef STATIC_MEMORY
+		static inline void * allocateLarge(Size bytes) {
+			Size total = header() + StaticMemory::bytes<char>(bytes);
+			LargeBlock * * best = 0;
+			for(LargeBlock * * l = &state().large; *l; l = &(*l)->next){
+				if ((*l)->bytes >= total && (!best || (*l)->bytes < (*best)->bytes)) best = l;
+			}
+			LargeBlock * block;
+			if (!best){
+				block = static_cast<LargeBlock *>(system(total));
+				if (!block) return 0;
+				block->bytes = total;
+			} else if ((*best)->bytes - total > header() + POOL_MAX_SIZE){
+				// Split off the end of the block, so the rest stays in the list as it is.
+				(*best)->bytes -= total;
+				block = reinterpret_cast<LargeBlock *>(reinterpret_cast<char *>(*best) + (*best)->bytes);
+				block->bytes = total;
+			} else {
+				block = *best;
+				*best = block->next;
+			}
+			return reinterpret_cast<char *>(block) + header();
+		}
+		
+		static inline void deallocateLarge(void * memory, Size) {
+			LargeBlock * block = reinterpret_cast<LargeBlock *>(static_cast<char *>(memory) - header());
+			LargeBlock * * l = &state().large;
+			LargeBlock * previous = 0;
+			while(*l && *l < block){ previous = *l; l = &(*l)->next; }
+			block->next = *l;
+			*l = block;
+			if (block->next && reinterpret_cast<char *>(block) + block->bytes == reinterpret_cast<char *>(block->next)){
+				block->bytes += block->next->bytes;
+				block->next = block->next->next;
+			}
+			if (previous && reinterpret_cast<char *>(previous) + previous->bytes == reinterpret_cast<char *>(block)){
+				previous->bytes += block->bytes;
+				previous->next = block->next;
+			}
+			// The lowest block can be at the top of the StaticMemory, after everything above it was merged into it.
+			LargeBlock * lowest = state().large;
+			if (StaticMemory::give(lowest, lowest->bytes)) state().large = lowest->next;
+		}
+#else
+		static inline void * allocateLarge(Size bytes) {
+			return malloc(bytes);
+		}
+		
+		static inline void deallocateLarge(void * memory, Size bytes) {
+			free(memory);
+		}
+#endif
+		
+		static inline Block * refill(Index size_class) {
+			Size size = classSize(size_class);
+			Size count = POOL_CHUNK_SIZE / size ? POOL_CHUNK_SIZE / size : 1;
+			char * chunk = static_cast<char *>(system(count * size));
+			if (!chunk && count > 1) chunk = static_cast<char *>(system((count = 1) * size));
+			if (!chunk) return 0;
+			State & s = state();
+			s.statistics.reserved += count * size;
+			s.statistics.chunks++;
+			for(Index i = 0; i < count; i++){
+				Block * block = reinterpret_cast<Block *>(chunk + i * size);
+				block->next = i + 1 < count ? reinterpret_cast<Block *>(chunk + (i + 1) * size) : 0;
+			}
+			return reinterpret_cast<Block *>(chunk);
+		}
+		
+		static inline void * obtain(Size bytes) {
+			State & s = state();
+			if (bytes > POOL_MAX_SIZE){
+				void * memory = allocateLarge(bytes);
+				if (memory) s.statistics.large += bytes;
+				return memory;
+			}
+			Index size_class = sizeClass(bytes);
+			Block * block = s.free[size_class];
+			if (!block && !(block = refill(size_class))) return 0;
+			s.free[size_class] = block->next;
+			s.in_use[size_class]++;
+			s.statistics.used += classSize(size_class);
+			s.statistics.requested += bytes;
+			s.statistics.blocks++;
+			return block;
+		}
+	
+	public:
+		
+		/// Allocate a number of bytes.
+		/**
+		 * \return The allocated memory, or 0 when the system is out of memory.
+		 */
+		static inline void * allocate(Size bytes) {
+#ifdef STATIC_MEMORY
+			if (StaticMemory::reserving()) return StaticMemory::reserve(bytes); // Machine::reserve() made sure it fits.
+			void * memory = obtain(bytes);
+			if (!memory && StaticMemory::exhausted()) memory = obtain(bytes);
+			if (!memory) abort();
+			return memory;
+#else
+			return obtain(bytes);
+#endif
+		}
+		
+		/// Deallocate memory allocated by allocate().
+		/**
+		 * \param memory The memory.
+		 * \param bytes The number of bytes given to allocate().
+		 */
+		static inline void deallocate(void * memory, Size bytes) {
+			if (!memory) return;
+#ifdef STATIC_MEMORY
+			if (StaticMemory::reserved(memory)) return;
+#endif
+			State & s = state();
+			if (bytes > POOL_MAX_SIZE){
+				s.statistics.large -= bytes;
+				deallocateLarge(memory, bytes);
+				return;
+			}
+			Index size_class = sizeClass(bytes);
+			Block * block = static_cast<Block *>(memory);
+			block->next = s.free[size_class];
+			s.free[size_class] = block;
+			s.in_use[size_class]--;
+			s.statistics.used -= classSize(size_class);
+			s.statistics.requested -= bytes;
+			s.statistics.blocks--;
+		}
+		
+		/// Get the memory usage statistics.
+		static inline Statistics const & statistics() {
+			return state().statistics;
+		}
+		
+		/// The size in bytes of the blocks of a size class.
+		static inline Size blockSize(Index size_class) {
+			return classSize(size_class);
+		}
+		
+		/// The number of blocks of a size class that are in use.
+		static inline Size blocksInUse(Index size_class) {
+			return state().in_use[size_class];
+		}
+	
+};
+
+/// An interface to the memory (de)allocation functions, using the Pool.
+/**
+ * This has the same interface as Memory.
+ * Memory uses this when \c POOL_MEMORY is defined.
+ *
+ * \tparam Element The type of the element(s) to (de)allocate.
+ */
+template<typename Element>
+class PoolMemory {
+	public:
+		
+		/// Allocate memory for a number of Elements (one when omitted).
+		static inline Element * allocate(Size capacity = 1) {
+			return static_cast<Element *>(Pool::allocate(capacity * sizeof(Element)));
+		}
+		
+		/// Deallocate memory, for the same number of Elements as given to allocate().
+		static inline void deallocate(Element * memory, Size capacity = 1) {
+			Pool::deallocate(memory, capacity * sizeof(Element));
+		}
+	
+};
+
+#endif
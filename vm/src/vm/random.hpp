@@ -33,7 +33,15 @@ class Random {
 		 * \return A random Number between min and max.
 		 */
 		static Number number(Number min, Number max) {
+#ifdef FIXED_POINT_NUMBER
+			// RAND_MAX does not fit in a Fixed, so use random bits as the fractional part directly.
+			// RAND_MAX is only guaranteed to be at least 0x7FFF (as it is on AVR), so take 15 bits at a time.
+			uint32_t bits = 0;
+			for(int b = 0; b < Number::fraction; b += 15) bits = bits << 15 | uint32_t(std::rand() & 0x7FFF);
+			return Number::fromRaw(Number::Raw(bits & ((uint32_t(1) << Number::fraction) - 1))) * (max - min) + min;
+#else
 			return Number(std::rand()) / Number(RAND_MAX) * (max - min) + min;
+#endif
 		}
 		
 };
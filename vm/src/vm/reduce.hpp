@@ -0,0 +1,197 @@
+/*   ____       _  __ _   ____            _
+ *  |  _ \  ___| |/ _| |_|  _ \ _ __ ___ | |_ ___
+ *  | | | |/ _ \ | |_| __| |_) | '__/ _ \| __/ _ \
+ *  | |_| |  __/ |  _| |_|  __/| | ( (_) | |( (_) )
+ *  |____/ \___|_|_|  \__|_|   |_|  \___/ \__\___/
+ *
+ * This file is part of DelftProto.
+ * See COPYING for license details.
+ */
+
+/// \file
+/// Provides the Reduce class.
+
+#ifndef __REDUCE_HPP
+#define __REDUCE_HPP
+
+#include <types.hpp>
+
+#ifdef FIXED_POINT_NUMBER
+#error Reduce can only be used with floating point Numbers.
+#endif
+
+/** \cond */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define REDUCE_X86
+#include <immintrin.h>
+#endif
+/** \endcond */
+
+/// Reductions of arrays of Numbers, using the widest vector instructions the processor supports.
+/**
+ * The instruction set is picked once at runtime, at the first reduction:
+ * AVX or SSE on x86 processors (when compiled with GCC or a compatible compiler), or plain C++ on anything else.
+ * 
+ * Values that are NaN are skipped, which is how NeighbourHood::numbers() marks imports that are not set.
+ * 
+ * \note Sums are not added in order, so the result may differ slightly from adding the values one by one.
+ */
+class Reduce {
+	
+	public:
+		/// A reduction of \a count Numbers starting at \a values.
+		typedef Number (*Kernel)(Number const * values, Size count);
+	
+	protected:
+		
+		struct Kernels {
+			char const * name;
+			Kernel sum;
+			Kernel minimum;
+			Kernel maximum;
+		};
+		
+		static inline Number sumScalar(Number const * values, Size count) {
+			Number sum = 0;
+			for(Index i = 0; i < count; i++) if (values[i] == values[i]) sum += values[i];
+			return sum;
+		}
+		
+		static inline Number minimumScalar(Number const * values, Size count) {
+			Number minimum = Number_infinity;
+			for(Index i = 0; i < count; i++) if (values[i] < minimum) minimum = values[i];
+			return minimum;
+		}
+		
+		static inline Number maximumScalar(Number const * values, Size count) {
+			Number maximum = -Number_infinity;
+			for(Index i = 0; i < count; i++) if (values[i] > maximum) maximum = values[i];
+			return maximum;
+		}
+
+#ifdef REDUCE_X86
+		// MINPS and MAXPS return their second operand when the first one is NaN, so the NaNs are skipped by keeping the accumulator second.
+		
+		__attribute__((target("sse"))) static Number sumSse(Number const * values, Size count) {
+			__m128 a = _mm_setzero_ps();
+			__m128 b = _mm_setzero_ps();
+			Index i = 0;
+			for(; i + 8 <= count; i += 8){
+				__m128 x = _mm_loadu_ps(values + i);
+				__m128 y = _mm_loadu_ps(values + i + 4);
+				a = _mm_add_ps(a, _mm_and_ps(_mm_cmpord_ps(x, x), x));
+				b = _mm_add_ps(b, _mm_and_ps(_mm_cmpord_ps(y, y), y));
+			}
+			float lanes[4];
+			_mm_storeu_ps(lanes, _mm_add_ps(a, b));
+			return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]) + sumScalar(values + i, count - i);
+		}
+		
+		__attribute__((target("sse"))) static Number minimumSse(Number const * values, Size count) {
+			__m128 m = _mm_set1_ps(Number_infinity);
+			Index i = 0;
+			for(; i + 4 <= count; i += 4) m = _mm_min_ps(_mm_loadu_ps(values + i), m);
+			float lanes[4];
+			_mm_storeu_ps(lanes, m);
+			Number minimum = minimumScalar(lanes, 4);
+			Number rest = minimumScalar(values + i, count - i);
+			return rest < minimum ? rest : minimum;
+		}
+		
+		__attribute__((target("sse"))) static Number maximumSse(Number const * values, Size count) {
+			__m128 m = _mm_set1_ps(-Number_infinity);
+			Index i = 0;
+			for(; i + 4 <= count; i += 4) m = _mm_max_ps(_mm_loadu_ps(values + i), m);
+			float lanes[4];
+			_mm_storeu_ps(lanes, m);
+			Number maximum = maximumScalar(lanes, 4);
+			Number rest = maximumScalar(values + i, count - i);
+			return rest > maximum ? rest : maximum;
+		}
+		
+		__attribute__((target("avx"))) static Number sumAvx(Number const * values, Size count) {
+			__m256 a = _mm256_setzero_ps();
+			__m256 b = _mm256_setzero_ps();
+			Index i = 0;
+			for(; i + 16 <= count; i += 16){
+				__m256 x = _mm256_loadu_ps(values + i);
+				__m256 y = _mm256_loadu_ps(values + i + 8);
+				a = _mm256_add_ps(a, _mm256_and_ps(_mm256_cmp_ps(x, x, _CMP_ORD_Q), x));
+				b = _mm256_add_ps(b, _mm256_and_ps(_mm256_cmp_ps(y, y, _CMP_ORD_Q), y));
+			}
+			__m256 s = _mm256_add_ps(a, b);
+			__m128 h = _mm_add_ps(_mm256_castps256_ps128(s), _mm256_extractf128_ps(s, 1));
+			float lanes[4];
+			_mm_storeu_ps(lanes, h);
+			return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]) + sumSse(values + i, count - i);
+		}
+		
+		__attribute__((target("avx"))) static Number minimumAvx(Number const * values, Size count) {
+			__m256 m = _mm256_set1_ps(Number_infinity);
+			Index i = 0;
+			for(; i + 8 <= count; i += 8) m = _mm256_min_ps(_mm256_loadu_ps(values + i), m);
+			float lanes[8];
+			_mm256_storeu_ps(lanes, m);
+			Number minimum = minimumScalar(lanes, 8);
+			Number rest = minimumSse(values + i, count - i);
+			return rest < minimum ? rest : minimum;
+		}
+		
+		__attribute__((target("avx"))) static Number maximumAvx(Number const * values, Size count) {
+			__m256 m = _mm256_set1_ps(-Number_infinity);
+			Index i = 0;
+			for(; i + 8 <= count; i += 8) m = _mm256_max_ps(_mm256_loadu_ps(values + i), m);
+			float lanes[8];
+			_mm256_storeu_ps(lanes, m);
+			Number maximum = maximumScalar(lanes, 8);
+			Number rest = maximumSse(values + i, count - i);
+			return rest > maximum ? rest : maximum;
+		}
+#endif
+		
+		static inline Kernels select() {
+#ifdef REDUCE_X86
+			__builtin_cpu_init();
+			if (__builtin_cpu_supports("avx")){
+				Kernels kernels = { "avx", sumAvx, minimumAvx, maximumAvx };
+				return kernels;
+			}
+			if (__builtin_cpu_supports("sse")){
+				Kernels kernels = { "sse", sumSse, minimumSse, maximumSse };
+				return kernels;
+			}
+#endif
+			Kernels kernels = { "scalar", sumScalar, minimumScalar, maximumScalar };
+			return kernels;
+		}
+		
+		static inline Kernels const & kernels() {
+			static Kernels const selected = select();
+			return selected;
+		}
+	
+	public:
+		
+		/// The sum of the values, or zero when there are none.
+		static inline Number sum(Number const * values, Size count) {
+			return kernels().sum(values, count);
+		}
+		
+		/// The smallest of the values, or infinity when there are none.
+		static inline Number minimum(Number const * values, Size count) {
+			return kernels().minimum(values, count);
+		}
+		
+		/// The largest of the values, or minus infinity when there are none.
+		static inline Number maximum(Number const * values, Size count) {
+			return kernels().maximum(values, count);
+		}
+		
+		/// The name of the instruction set that is used: \c "avx", \c "sse" or \c "scalar".
+		static inline char const * instructionSet() {
+			return kernels().name;
+		}
+	
+};
+
+#endif
@@ -0,0 +1,70 @@
+/*   ____       _  __ _   ____            _
+ *  |  _ \  ___| |/ _| |_|  _ \ _ __ ___ | |_ ___
+ *  | | | |/ _ \ | |_| __| |_) | '__/ _ \| __/ _ \
+ *  | |_| |  __/ |  _| |_|  __/| | ( (_) | |( (_) )
+ *  |____/ \___|_|_|  \__|_|   |_|  \___/ \__\___/
+ *
+ * This file is part of DelftProto.
+ * See COPYING for license details.
+ */
+
+/// \file
+/// Provides the ReferenceCount class.
+
+#ifndef __REFERENCECOUNT_HPP
+#define __REFERENCECOUNT_HPP
+
+#include <types.hpp>
+
+/// A reference counter.
+/**
+ * By default, this is a plain Counter.
+ *
+ * When \c ATOMIC_REFERENCE_COUNT is defined, the counter is updated atomically,
+ * so that objects (such as the contents of a SharedVector) can be shared between Machines running in different threads.
+ * Increments are relaxed (a new reference can only be made from an existing one),
+ * and decrements are acquire-release (so that all uses of the object happen before it is destroyed by the last owner).
+ *
+ * \note Only the counter is made thread safe. Memory, Pool, Region and MemoryStatistics are not,
+ *       so the object must only be deallocated by a thread that may use the allocator.
+ */
+class ReferenceCount {
+	
+	protected:
+		Counter count;
+	
+	public:
+		
+		/// Start with the given number of references.
+		inline explicit ReferenceCount(Counter count) : count(count) {}
+		
+		/// Add a reference.
+		inline void increment() {
+#ifdef ATOMIC_REFERENCE_COUNT
+			__atomic_fetch_add(&count, 1, __ATOMIC_RELAXED);
+#else
+			count++;
+#endif
+		}
+		
+		/// Remove a reference, and check whether any are left (true) or not (false).
+		inline bool decrement() {
+#ifdef ATOMIC_REFERENCE_COUNT
+			return __atomic_sub_fetch(&count, 1, __ATOMIC_ACQ_REL);
+#else
+			return --count;
+#endif
+		}
+		
+		/// The number of references.
+		inline operator Counter() const {
+#ifdef ATOMIC_REFERENCE_COUNT
+			return __atomic_load_n(&count, __ATOMIC_RELAXED);
+#else
+			return count;
+#endif
+		}
+	
+};
+
+#endif
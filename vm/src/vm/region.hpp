@@ -0,0 +1,236 @@
+/*   ____       _  __ _   ____            _
+ *  |  _ \  ___| |/ _| |_|  _ \ _ __ ___ | |_ ___
+ *  | | | |/ _ \ | |_| __| |_) | '__/ _ \| __/ _ \
+ *  | |_| |  __/ |  _| |_|  __/| | ( (_) | |( (_) )
+ *  |____/ \___|_|_|  \__|_|   |_|  \___/ \__\___/
+ *
+ * This file is part of DelftProto.
+ * See COPYING for license details.
+ */
+
+/// \file
+/// Provides the Region and RegionMemory classes.
+
+#ifndef __REGION_HPP
+#define __REGION_HPP
+
+extern "C" {
+#	include <stdint.h>
+}
+
+#include <types.hpp>
+#include <memory.hpp>
+
+/// A bump pointer allocator that is reset as a whole.
+/**
+ * Used by the Machine (when \c ROUND_REGION_SIZE is defined) for the temporary tuples of a single run.
+ * Allocating is a pointer increment, deallocating does nothing, and all memory is reclaimed at once by reset().
+ *
+ * Only one Region is active at a time. RegionMemory allocates from the active one, or falls back to Memory when there is none or it is full.
+ *
+ * All Regions are kept in a hash table by the granules (aligned blocks of 4 KiB) of memory they overlap,
+ * so that memory from any Region (active or not) is recognized in constant time when it is deallocated.
+ */
+class Region {
+	
+	protected:
+		
+		/// The allocation unit, which makes sure all allocations are suitably aligned.
+		union Unit {
+			void * pointer;
+			double number;
+			long integer;
+			Alignment alignment;
+		};
+		
+		Unit * base;
+		Size capacity;
+		Size used;
+		
+		bool overflow;
+		
+		static const Size granule_bits = 12;
+		
+		// A granule that a Region overlaps, in the hash table of all Regions.
+		struct Entry {
+			Size granule;
+			Region * region; // Zero for an empty slot.
+		};
+		
+		// The hash table of all Regions, with linear probing.
+		struct Table {
+			Entry * entries;
+			Size capacity; // A power of two, or zero.
+			Size size;
+		};
+		
+		static inline Table & table() {
+			static Table t = { 0, 0, 0 };
+			return t;
+		}
+		
+		static inline Size granule(void const * memory) {
+			return Size(reinterpret_cast<uintptr_t>(memory) >> granule_bits);
+		}
+		
+		static inline Index slot(Size granule) {
+			return Index(granule * 2654435761u) & (table().capacity - 1);
+		}
+		
+		static inline void insert(Size granule, Region * region) {
+			Table & t = table();
+			if ((t.size + 1) * 2 > t.capacity){
+				Entry * old = t.entries;
+				Size old_capacity = t.capacity;
+				t.capacity = old_capacity ? old_capacity * 2 : 16;
+				t.entries = Memory<Entry>::allocate(t.capacity);
+				t.size = 0;
+				for(Index i = 0; i < t.capacity; i++) t.entries[i].region = 0;
+				for(Index i = 0; i < old_capacity; i++) if (old[i].region) insert(old[i].granule, old[i].region);
+				if (old) Memory<Entry>::deallocate(old, old_capacity);
+			}
+			Index i = slot(granule);
+			while(t.entries[i].region) i = (i + 1) & (t.capacity - 1);
+			t.entries[i].granule = granule;
+			t.entries[i].region = region;
+			t.size++;
+		}
+		
+		static inline void erase(Size granule, Region * region) {
+			Table & t = table();
+			Index i = slot(granule);
+			while(!(t.entries[i].granule == granule && t.entries[i].region == region)) i = (i + 1) & (t.capacity - 1);
+			// Move the later entries of the probe sequence back, to close the gap.
+			for(Index j = (i + 1) & (t.capacity - 1); t.entries[j].region; j = (j + 1) & (t.capacity - 1)){
+				Index home = slot(t.entries[j].granule);
+				if (((j - home) & (t.capacity - 1)) >= ((j - i) & (t.capacity - 1))){
+					t.entries[i] = t.entries[j];
+					i = j;
+				}
+			}
+			t.entries[i].region = 0;
+			if (!--t.size){
+				Memory<Entry>::deallocate(t.entries, t.capacity);
+				t.entries = 0;
+				t.capacity = 0;
+			}
+		}
+	
+	public:
+		
+		/// Create a Region of the given size in bytes.
+		explicit Region(Size bytes) : base(Memory<Unit>::allocate((bytes + sizeof(Unit) - 1) / sizeof(Unit))), capacity((bytes + sizeof(Unit) - 1) / sizeof(Unit)), used(0), overflow(false) {
+			for(Size g = granule(base); g <= granule(base + capacity - 1); g++) insert(g, this);
+		}
+		
+		~Region() {
+			for(Size g = granule(base); g <= granule(base + capacity - 1); g++) erase(g, this);
+			Memory<Unit>::deallocate(base, capacity);
+		}
+		
+		/// The active region, or 0 when there is none.
+		static inline Region * & active() {
+			static Region * region = 0;
+			return region;
+		}
+		
+		/// Find the region containing the given memory, or 0 when it is not in any region.
+		/**
+		 * This takes constant time: the active Region is checked first, and then the Regions overlapping the granule of the memory.
+		 */
+		static inline Region * owner(void const * memory) {
+			Region * region = active();
+			if (region && region->contains(memory)) return region;
+			Table & t = table();
+			if (!t.size) return 0;
+			Size g = granule(memory);
+			for(Index i = slot(g); t.entries[i].region; i = (i + 1) & (t.capacity - 1)){
+				if (t.entries[i].granule == g && t.entries[i].region->contains(memory)) return t.entries[i].region;
+			}
+			return 0;
+		}
+		
+		/// Allocate memory for a number of Elements, or return 0 when there is not enough space left.
+		template<typename Element>
+		inline Element * allocate(Size count) {
+			Size units = (count * sizeof(Element) + sizeof(Unit) - 1) / sizeof(Unit);
+			if (units > capacity - used) {
+				overflow = true;
+				return 0;
+			}
+			Unit * memory = base + used;
+			used += units;
+			return reinterpret_cast<Element *>(memory);
+		}
+		
+		/// Check whether the memory is part of this region.
+		inline bool contains(void const * memory) const {
+			return memory >= static_cast<void const *>(base) && memory < static_cast<void const *>(base + capacity);
+		}
+		
+		/// Check whether an allocation did not fit since the last reset().
+		/**
+		 * The allocations that did not fit are done by Memory instead.
+		 */
+		inline bool overflowed() const {
+			return overflow;
+		}
+		
+		/// The number of bytes currently allocated.
+		inline Size size() const {
+			return used * sizeof(Unit);
+		}
+		
+		/// Free all memory at once.
+		/**
+		 * \warning Nothing allocated in this region may be used anymore afterwards.
+		 */
+		inline void reset() {
+			used = 0;
+			overflow = false;
+		}
+		
+		/// Activates a Region for the lifetime of this object.
+		class Scope {
+			protected:
+				Region * previous;
+			public:
+				inline explicit Scope(Region * region) : previous(active()) { active() = region; }
+				inline ~Scope() { active() = previous; }
+		};
+	
+	private:
+		Region(Region const &);
+		Region & operator = (Region const &);
+	
+};
+
+/// An interface to the memory (de)allocation functions, using the active Region when there is one.
+/**
+ * This has the same interface as Memory.
+ *
+ * \tparam Element The type of the element(s) to (de)allocate.
+ */
+template<typename Element>
+class RegionMemory {
+	public:
+		
+		/// Allocate memory, from the active Region if there is one and it has enough space left.
+		/**
+		 * \param capacity The number of Elements, or one when omitted.
+		 * \param near When given, only use the active Region if this memory is in the active Region too.
+		 */
+		static inline Element * allocate(Size capacity = 1, void const * near = 0) {
+			Region * region = Region::active();
+			Element * memory = region && (!near || region->contains(near)) ? region->allocate<Element>(capacity) : 0;
+			return memory ? memory : Memory<Element>::allocate(capacity);
+		}
+		
+		/// Deallocate memory. This does nothing for memory in a Region.
+		static inline void deallocate(Element * memory, Size capacity = 1) {
+			if (!Region::owner(memory)) Memory<Element>::deallocate(memory, capacity);
+		}
+	
+};
+
+#endif
@@ -16,6 +16,41 @@
 
 #include <types.hpp>
 #include <memory.hpp>
+#include <referencecount.hpp>
+
+#if defined(HEAP_SIZE) && defined(ROUND_REGION_SIZE)
+#error HEAP_SIZE and ROUND_REGION_SIZE can not be used together.
+#endif
+
+#ifdef HEAP_SIZE
+#include <heap.hpp>
+#endif
+
+#ifdef ROUND_REGION_SIZE
+#include <region.hpp>
+#endif
+
+/** \cond */
+#if defined(HEAP_SIZE)
+template<typename Element>
+class VectorMemory : public HeapMemory<Element> {};
+#elif defined(ROUND_REGION_SIZE)
+template<typename Element>
+class VectorMemory : public RegionMemory<Element> {
+	public:
+		typedef Element * Pointer;
+};
+#else
+template<typename Element>
+class VectorMemory : public Memory<Element> {
+	public:
+		typedef Element * Pointer;
+		static inline Element * allocate(Size capacity = 1, void const * near = 0) {
+			return Memory<Element>::allocate(capacity);
+		}
+};
+#endif
+/** \endcond */
 
 /// A vector with shared contents.
 /**
@@ -23,6 +58,13 @@
  * 
  * The contents will be shared across copies of an instance, unless created by copy().
  * 
+ * When \c ATOMIC_REFERENCE_COUNT is defined, the contents can be shared between threads (see ReferenceCount).
+ * 
+ * When \c ROUND_REGION_SIZE is defined, new vectors are allocated in the active Region (if any),
+ * and their elements are allocated in the same Region as the vector itself.
+ * 
+ * When \c HEAP_SIZE is defined, the contents and the elements are allocated in the Heap, and referred to by HeapPointers.
+ * 
  * \tparam Element The type of elements in the vector.
  */
 template<typename Element>
@@ -30,30 +72,35 @@ class SharedVector {
 	
 	protected:
 		
+		class VectorData;
+		
+		typedef typename VectorMemory<VectorData>::Pointer Pointer;
+		
 		class VectorData {
 			
 			protected:
-				mutable Counter reference_count;
+				mutable ReferenceCount reference_count;
 				Size vectorsize;
 				Size vectorcapacity;
-				Element * elements;
+				typename VectorMemory<Element>::Pointer elements;
 				
 				inline void reset(Size size = 0) {
 					if (elements){
 						for(Index i = 0; i < vectorsize; i++) elements[i].~Element();
-						Memory<Element>::deallocate(elements, vectorcapacity);
+						VectorMemory<Element>::deallocate(elements, vectorcapacity);
 					}
-					vectorsize = size;
-					elements = vectorsize ? Memory<Element>::allocate(size) : 0;
+					vectorsize = 0;
+					vectorcapacity = size;
+					elements = vectorcapacity ? VectorMemory<Element>::allocate(size, this) : typename VectorMemory<Element>::Pointer();
 				}
 				
 				inline void grow(Size extra_capacity = 1) {
-					Element * new_elements = Memory<Element>::allocate(vectorcapacity + extra_capacity);
+					typename VectorMemory<Element>::Pointer new_elements = VectorMemory<Element>::allocate(vectorcapacity + extra_capacity, this);
 					for(Index i = 0; i < vectorsize; i++){
 						new (&new_elements[i]) Element(elements[i]);
 						elements[i].~Element();
 					}
-					if (elements) Memory<Element>::deallocate(elements,vectorcapacity);
+					if (elements) VectorMemory<Element>::deallocate(elements,vectorcapacity);
 					vectorcapacity += extra_capacity;
 					elements = new_elements;
 				}
@@ -62,11 +109,13 @@ class SharedVector {
 					reset();
 				}
 				
+				friend class SharedVector;
+			
 			public:
-				inline VectorData() : reference_count(1), vectorsize(0), vectorcapacity(0), elements(0) {}
-				inline explicit VectorData(Size capacity) : reference_count(1), vectorsize(0), vectorcapacity(capacity), elements(Memory<Element>::allocate(vectorcapacity)) {}
+				inline VectorData() : reference_count(1), vectorsize(0), vectorcapacity(0), elements() {}
+				inline explicit VectorData(Size capacity) : reference_count(1), vectorsize(0), vectorcapacity(capacity), elements(VectorMemory<Element>::allocate(vectorcapacity, this)) {}
 				
-				inline VectorData(VectorData const & vector, Size free_space = 0) : reference_count(1), vectorsize(0), vectorcapacity(vector.size() + free_space), elements(Memory<Element>::allocate(vectorcapacity)) {
+				inline VectorData(VectorData const & vector, Size free_space = 0) : reference_count(1), vectorsize(0), vectorcapacity(vector.size() + free_space), elements(VectorMemory<Element>::allocate(vectorcapacity, this)) {
 					for(;vectorsize < vector.size(); vectorsize++) new (&elements[vectorsize]) Element(vector.elements[vectorsize]);
 				}
 				
@@ -82,37 +131,46 @@ class SharedVector {
 				inline operator Element       * ()       { return elements; }
 				inline operator Element const * () const { return elements; }
 				
-				inline VectorData       * grab()       { reference_count++; return this; }
-				inline VectorData const * grab() const { reference_count++; return this; }
-				
-				inline void release() const {
-					if (!--reference_count){
-						this->~VectorData();
-						Memory<VectorData>::deallocate(const_cast<VectorData *>(this));
-					}
-				}
+				inline void grab   () const { reference_count.increment(); }
+				inline bool release() const { return reference_count.decrement(); } // Check whether there are references left.
 				
 				inline VectorData & operator = (VectorData const & vector){
 					reset(vector.size());
 					for(;vectorsize < vector.size(); vectorsize++) new (&elements[vectorsize]) Element(vector.elements[vectorsize]);
+					return *this;
 				}
-				
-		} * data;
+			
+		};
 		
-		inline SharedVector(VectorData * data) : data(data) {}
+		Pointer data;
 		
+		inline explicit SharedVector(Pointer data) : data(data) {}
+		
+		inline void release() {
+			if (!data->release()){
+				data->~VectorData();
+				VectorMemory<VectorData>::deallocate(data);
+			}
+		}
+	
 	public:
 		/// Construct an empty vector.
-		inline SharedVector() : data(new (Memory<VectorData>::allocate()) VectorData()) {}
+		inline SharedVector() : data(VectorMemory<VectorData>::allocate()) {
+			new (data) VectorData();
+		}
 		
 		/// Allocate a new vector with the specified initial capacity.
-		inline explicit SharedVector(Size capacity) : data(new (Memory<VectorData>::allocate()) VectorData(capacity)) {}
+		inline explicit SharedVector(Size capacity) : data(VectorMemory<VectorData>::allocate()) {
+			new (data) VectorData(capacity);
+		}
 		
 		/// Construct another instance of this vector.
 		/**
 		 * \note The contents will be shared. Use copy() to get a copy.
 		 */
-		inline SharedVector(SharedVector const & vector) : data(vector.data->grab()) {}
+		inline SharedVector(SharedVector const & vector) : data(vector.data) {
+			data->grab();
+		}
 		
 		/// Get access the elements.
 		inline operator Element       * ()       { return *data; }
@@ -133,8 +191,9 @@ class SharedVector {
 		 * \endcode
 		 */
 		inline SharedVector & operator = (SharedVector const & vector) {
-			data->release();
-			data = vector.data->grab();
+			vector.data->grab();
+			release();
+			data = vector.data;
 			return *this;
 		}
 		
@@ -143,7 +202,9 @@ class SharedVector {
 		 * All elements will be copied using their own copy constructor.
 		 */
 		inline SharedVector copy() const {
-			return SharedVector(new (Memory<VectorData>::allocate()) VectorData(*data));
+			Pointer copy = VectorMemory<VectorData>::allocate();
+			new (copy) VectorData(*data);
+			return SharedVector(copy);
 		}
 		
 		/// The number of elements in this vector.
@@ -165,15 +226,22 @@ class SharedVector {
 		inline Counter instances() const {
 			return data->references();
 		}
+
+#ifdef ROUND_REGION_SIZE
+		/// Check whether the contents are allocated in a Region.
+		inline bool temporary() const {
+			return Region::owner(data);
+		}
+#endif
 		
 		/// Deconstruct the vector.
 		/**
 		 * If this was the last instance of this vector, the contents will be deconstructed and deallocated as well.
 		 */
 		inline ~SharedVector() {
-			data->release();
+			release();
 		}
-		
+	
 };
 
 #endif
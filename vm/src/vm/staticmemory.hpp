@@ -0,0 +1,243 @@
+/*   ____       _  __ _   ____            _
+ *  |  _ \  ___| |/ _| |_|  _ \ _ __ ___ | |_ ___
+ *  | | | |/ _ \ | |_| __| |_) | '__/ _ \| __/ _ \
+ *  | |_| |  __/ |  _| |_|  __/| | ( (_) | |( (_) )
+ *  |____/ \___|_|_|  \__|_|   |_|  \___/ \__\___/
+ *
+ * This file is part of DelftProto.
+ * See COPYING for license details.
+ */
+
+/// \file
+/// Provides the StaticMemory class.
+
+extern "C" {
+#	include <stdlib.h>
+}
+
+#ifndef __STATICMEMORY_HPP
+#define __STATICMEMORY_HPP
+
+#include <types.hpp>
+
+/** \cond */
+#ifndef STATIC_MEMORY_SPARE
+#define STATIC_MEMORY_SPARE (STATIC_MEMORY / 8)
+#endif
+/** \endcond */
+
+/// One statically allocated block of \c STATIC_MEMORY bytes, used instead of the system allocator.
+/**
+ * When \c STATIC_MEMORY is defined, all memory of the VM is taken from this block, and the system allocator is never used.
+ *
+ * The bottom of the block holds the reservations: the stacks and arrays allocated by DEF_VM and DEF_VM_EX
+ * (see Machine::reserve()), which live until the next installation or the destruction of their Machine, and are then given back at once.
+ * The top of the block is used by the Pool, for everything allocated while the VM is running (tuples, neighbours, ...).
+ * The Pool reuses the memory it gets for allocations of the same size class, and merges the larger blocks it gets back,
+ * to reuse them for any allocation that fits, or to give them back when they are at the top (see give()).
+ *
+ * When a reservation does not fit, the installation is aborted and failed() is set.
+ *
+ * The last \c STATIC_MEMORY_SPARE bytes (an eighth of the block by default) are kept free as a spare.
+ * When the Pool runs out of memory, failed() is set and the spare is made available (see exhausted()),
+ * so that the current Machine::step() can finish, after which the Machine ends the installation or run as if the installation did not fit.
+ * Only when the spare runs out as well, the VM aborts.
+ * (So does running out twice outside of Machine::step() and Machine::run(), for example while the platform adds neighbours itself,
+ * because then nothing ends to give the memory back.)
+ * A platform can define \c STATIC_MEMORY_EXHAUSTED() to handle running out of memory itself instead (for example by resetting the device),
+ * in which case it is called when the Pool runs out of memory, and must not return.
+ */
+class StaticMemory {
+	
+	protected:
+		
+		/// The allocation unit, which makes sure all allocations are suitably aligned.
+		union Unit {
+			void * pointer;
+			double number;
+			long integer;
+			Alignment alignment;
+		};
+		
+		static const Size capacity = (STATIC_MEMORY + sizeof(Unit) - 1) / sizeof(Unit);
+		
+		static const Size spare = (STATIC_MEMORY_SPARE + sizeof(Unit) - 1) / sizeof(Unit);
+		
+		// A reservation that was given back while a later one was still in use, stored in its own memory.
+		struct Hole {
+			Size end;  // The end of the reservation, in units.
+			Size next; // The start of the next Hole, or capacity for none.
+		};
+		
+		struct State {
+			Unit block[capacity];
+			Size bottom; // The end of the reservations, in units.
+			Size top;    // The start of the memory of the Pool, in units.
+			Size holes;  // The start of the first Hole, or capacity for none.
+			bool reserving;
+			bool failed;
+			bool using_spare;
+			Size exhaustions;
+			State() : bottom(0), top(capacity), holes(capacity), reserving(false), failed(false), using_spare(false), exhaustions(0) {}
+		};
+		
+		static inline State & state() {
+			static State s;
+			return s;
+		}
+		
+		static inline Hole & hole(Size begin) {
+			return *reinterpret_cast<Hole *>(state().block + begin);
+		}
+		
+		// The number of units between the reservations and the Pool that can be used, which excludes the spare when it is not in use.
+		static inline Size usable() {
+			State & s = state();
+			Size keep = s.using_spare ? 0 : spare;
+			return s.top - s.bottom > keep ? s.top - s.bottom - keep : 0;
+		}
+	
+	public:
+		
+		/// The position of a reservation in the block.
+		struct Mark {
+			Size begin;
+			Size end;
+			Mark() : begin(0), end(0) {}
+		};
+		
+		/// The number of units needed for a number of bytes.
+		static inline Size units(Size bytes) {
+			return (bytes + sizeof(Unit) - 1) / sizeof(Unit);
+		}
+		
+		/// The number of bytes a reservation of a number of Elements takes.
+		template<typename Element>
+		static inline Size bytes(Size count) {
+			return units(count * sizeof(Element)) * sizeof(Unit);
+		}
+		
+		/// The number of bytes that are neither reserved nor used by the Pool, excluding the spare when it is not in use.
+		static inline Size available() {
+			return usable() * sizeof(Unit);
+		}
+		
+		/// Check whether the memory is part of a reservation.
+		static inline bool reserved(void const * memory) {
+			State & s = state();
+			return memory >= static_cast<void const *>(s.block) && memory < static_cast<void const *>(s.block + s.bottom);
+		}
+		
+		/// Check whether new allocations are reservations.
+		static inline bool reserving() {
+			return state().reserving;
+		}
+		
+		/// Allocate memory at the bottom of the block, or return 0 when it does not fit.
+		static inline void * reserve(Size bytes) {
+			State & s = state();
+			Size n = units(bytes);
+			if (n > usable()) return 0;
+			s.bottom += n;
+			return s.block + s.bottom - n;
+		}
+		
+		/// Allocate memory at the top of the block, or return 0 when it does not fit.
+		static inline void * take(Size bytes) {
+			State & s = state();
+			Size n = units(bytes);
+			if (n > usable()) return 0;
+			s.top -= n;
+			return s.block + s.top;
+		}
+		
+		/// Give back memory at the top of the block, when it is the memory that was taken last (and not given back yet).
+		/**
+		 * \return Whether the memory was given back.
+		 */
+		static inline bool give(void * memory, Size bytes) {
+			State & s = state();
+			if (memory != static_cast<void *>(s.block + s.top)) return false;
+			s.top += units(bytes);
+			return true;
+		}
+		
+		/// Give back a reservation.
+		/**
+		 * When a later reservation is still in use, the memory is kept as a hole, which is given back
+		 * together with the reservation below which it lies. (A hole too small to remember itself is lost.)
+		 *
+		 * \warning Nothing in the reservation may be used anymore afterwards.
+		 */
+		static inline void release(Mark & mark) {
+			State & s = state();
+			if (mark.end == s.bottom){
+				s.bottom = mark.begin;
+				for(Size * h = &s.holes; *h != capacity;){
+					if (hole(*h).end != s.bottom){
+						h = &hole(*h).next;
+						continue;
+					}
+					s.bottom = *h;
+					*h = hole(*h).next;
+					h = &s.holes;
+				}
+			} else if (mark.end - mark.begin >= units(sizeof(Hole))){
+				hole(mark.begin).end = mark.end;
+				hole(mark.begin).next = s.holes;
+				s.holes = mark.begin;
+			}
+			mark = Mark();
+		}
+		
+		/// Check whether a reservation did not fit or the Pool ran out of memory.
+		static inline bool failed() {
+			return state().failed;
+		}
+		
+		/// Record that a reservation did not fit.
+		static inline void fail() {
+			state().failed = true;
+		}
+		
+		/// Handle the Pool running out of memory: set failed(), count it in exhaustions(), and make the spare available.
+		/**
+		 * \return Whether the spare was made available, or false when it already was (and it ran out as well).
+		 */
+		static inline bool exhausted() {
+			State & s = state();
+			s.failed = true;
+#ifdef STATIC_MEMORY_EXHAUSTED
+			STATIC_MEMORY_EXHAUSTED();
+#endif
+			if (s.using_spare) return false;
+			s.using_spare = true;
+			s.exhaustions++;
+			return true;
+		}
+		
+		/// The number of times the Pool ran out of memory.
+		static inline Size exhaustions() {
+			return state().exhaustions;
+		}
+		
+		/// Keep the spare free again, after the memory in use when the Pool ran out was given back.
+		/**
+		 * The Pool keeps the blocks it took from the spare, so the spare is again made of the last free bytes below those.
+		 */
+		static inline void recovered() {
+			state().using_spare = false;
+		}
+		
+		/// Makes all allocations reservations for the lifetime of this object.
+		class Reservation {
+			protected:
+				Mark & mark;
+			public:
+				inline explicit Reservation(Mark & mark) : mark(mark) { mark.begin = mark.end = state().bottom; state().reserving = true; }
+				inline ~Reservation() { mark.end = state().bottom; state().reserving = false; }
+		};
+	
+};
+
+#endif
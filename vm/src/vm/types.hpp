@@ -45,10 +45,31 @@ typedef unsigned int Int;
 /// The memory is aligned by this type.
 typedef unsigned char Alignment;
 
+#ifdef FIXED_POINT_NUMBER
+
+#include <fixed.hpp>
+
+/** \class Number
+ * \brief A fixed point number with \c FIXED_POINT_NUMBER fractional bits.
+ * 
+ * One of the types that can be stored in Data.
+ * 
+ * \see Fixed
+ */
+typedef Fixed<FIXED_POINT_NUMBER> Number;
+
+namespace {
+	const Number Number_infinity = Number::infinity();
+}
+
+#else
+
 /** \class Number
  * \brief A floating point number.
  * 
  * One of the types that can be stored in Data.
+ * 
+ * Define \c FIXED_POINT_NUMBER to the number of fractional bits to use a Fixed point number instead.
  */
 typedef float Number;
 
@@ -59,3 +80,5 @@ namespace {
 }
 
 #endif
+
+#endif
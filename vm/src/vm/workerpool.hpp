@@ -0,0 +1,138 @@
+/*   ____       _  __ _   ____            _
+ *  |  _ \  ___| |/ _| |_|  _ \ _ __ ___ | |_ ___
+ *  | | | |/ _ \ | |_| __| |_) | '__/ _ \| __/ _ \
+ *  | |_| |  __/ |  _| |_|  __/| | ( (_) | |( (_) )
+ *  |____/ \___|_|_|  \__|_|   |_|  \___/ \__\___/
+ *
+ * This file is part of DelftProto.
+ * See COPYING for license details.
+ */
+
+/// \file
+/// Provides the WorkerPool class.
+
+extern "C" {
+#	include <pthread.h>
+}
+
+#ifndef __WORKERPOOL_HPP
+#define __WORKERPOOL_HPP
+
+#include <types.hpp>
+#include <memory.hpp>
+
+/// A fixed number of threads that run the chunks of a task in parallel.
+/**
+ * The thread calling run() works on the chunks as well, and run() returns when all chunks are done.
+ * The threads are started by the first run() that has more than one chunk, and stopped when the WorkerPool is destructed.
+ * 
+ * Which thread runs which chunk is not defined, so a task that must give the same result every time
+ * should only write a separate result per chunk, and combine those in order afterwards.
+ * 
+ * This uses POSIX threads, so it is only available on hosts that have them.
+ */
+class WorkerPool {
+	
+	public:
+		/// A part of a task: does the work of the given chunk of the task described by the context.
+		typedef void (*Task)(void * context, Index chunk);
+	
+	protected:
+		
+		Size workers;
+		Size started;
+		pthread_t * threads;
+		
+		pthread_mutex_t mutex;
+		pthread_cond_t work_available;
+		pthread_cond_t work_done;
+		
+		Task task;
+		void * context;
+		Size chunks;
+		Index next_chunk;
+		Size unfinished;
+		bool stopping;
+		
+		// Run chunks until none are left. Called and returns with the mutex locked.
+		inline void help() {
+			while(next_chunk < chunks){
+				Index chunk = next_chunk++;
+				pthread_mutex_unlock(&mutex);
+				task(context, chunk);
+				pthread_mutex_lock(&mutex);
+				if (--unfinished == 0) pthread_cond_broadcast(&work_done);
+			}
+		}
+		
+		static void * work(void * argument) {
+			WorkerPool & pool = *static_cast<WorkerPool *>(argument);
+			pthread_mutex_lock(&pool.mutex);
+			while(!pool.stopping){
+				pool.help();
+				pthread_cond_wait(&pool.work_available, &pool.mutex);
+			}
+			pthread_mutex_unlock(&pool.mutex);
+			return 0;
+		}
+		
+		inline void start() {
+			threads = Memory<pthread_t>::allocate(workers);
+			// Continue with the threads that could be started, if not all of them.
+			while(started < workers && !pthread_create(&threads[started], 0, work, this)) started++;
+		}
+	
+	public:
+		
+		/// Create a pool of the given number of threads (besides the thread calling run()).
+		explicit inline WorkerPool(Size workers) : workers(workers), started(0), threads(0), task(0), context(0), chunks(0), next_chunk(0), unfinished(0), stopping(false) {
+			pthread_mutex_init(&mutex, 0);
+			pthread_cond_init(&work_available, 0);
+			pthread_cond_init(&work_done, 0);
+		}
+		
+		inline ~WorkerPool() {
+			if (threads){
+				pthread_mutex_lock(&mutex);
+				stopping = true;
+				pthread_cond_broadcast(&work_available);
+				pthread_mutex_unlock(&mutex);
+				for(Index i = 0; i < started; i++) pthread_join(threads[i], 0);
+				Memory<pthread_t>::deallocate(threads, workers);
+			}
+			pthread_cond_destroy(&work_done);
+			pthread_cond_destroy(&work_available);
+			pthread_mutex_destroy(&mutex);
+		}
+		
+		/// Run the chunks 0 to \a chunks - 1 of a task, and wait for all of them to finish.
+		inline void run(Task task, void * context, Size chunks) {
+			if (chunks == 1 || !workers){
+				for(Index i = 0; i < chunks; i++) task(context, i);
+				return;
+			}
+			if (!threads) start();
+			pthread_mutex_lock(&mutex);
+			this->task = task;
+			this->context = context;
+			this->chunks = chunks;
+			next_chunk = 0;
+			unfinished = chunks;
+			pthread_cond_broadcast(&work_available);
+			help();
+			while(unfinished) pthread_cond_wait(&work_done, &mutex);
+			pthread_mutex_unlock(&mutex);
+		}
+		
+		/// The number of threads that are running (besides the thread calling run()).
+		inline Size size() const {
+			return started;
+		}
+	
+	private:
+		WorkerPool(WorkerPool const &);
+		WorkerPool & operator = (WorkerPool const &);
+	
+};
+
+#endif